@@ -5,100 +5,798 @@
  * of the MIT license. See the LICENSE file for details.
  */
 
-#include <QCoreApplication>
-#include <QCommandLineParser>
-#include <QTimer>
-#include <QString>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
 #include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
-#include "q-ctl-client.hpp"
+#include "proto.hpp"
+#include "client.hpp"
+
+namespace {
+
+/*
+ * Command to send.
+ */
+enum class Command
+{
+    Pick,
+    Find,
+    Stats,
+    Watch,
+    Reload,
+    Quit,
+};
 
 struct Params final
 {
-    jome::QCtlClient::Command cmd = jome::QCtlClient::Command::Pick;
-    QString serverName;
+    Command cmd = Command::Pick;
+    std::string serverName;
+    bool spawnServer = false;
+    bool fromStdin = false;
+
+    // output option fields
+    jome::proto::Fields optFields;
+
+    std::optional<unsigned int> emojiWidth;
+    std::optional<unsigned int> limit;
+
+    // find query (`find` command)
+    std::string query;
 };
 
-namespace {
+// maximum delay between two connection attempts after spawning (ms)
+constexpr unsigned int maxRetryDelayMs = 250;
+
+// maximum time to wait for a spawned server
+constexpr std::chrono::seconds maxSpawnWait {10};
+
+// maximum time to wait for the reply to a request which doesn't show the window (ms)
+constexpr unsigned int replyTimeoutMs = 10000;
+
+// maximum number of requests in flight with `--stdin`
+constexpr std::size_t maxPendingReqCount = 128;
+
+void printUsage(std::ostream& os)
+{
+    os << "Usage: jome-ctl [options] NAME [CMD] [QUERY...]\n"
+          "       jome-ctl [options] NAME --stdin\n"
+          "Control jome\n"
+          "\n"
+          "Options:\n"
+          "  -h, --help    Displays help on commandline options.\n"
+          "  -v, --version Displays version information.\n"
+          "  -i, --stdin   Read commands (`CMD [QUERY...]`), one per line, from the\n"
+          "                standard input and send them over a single connection.\n"
+          "  -D            Control the default jome server (don't pass a server name).\n"
+          "  -S            Start the jome server if it's not running.\n"
+          "  -w WIDTH      Set the emoji width to WIDTH pixels (16, 24, 32, 40, or 48)\n"
+          "                for `pick`.\n"
+          "  -l COUNT      Output at most COUNT emojis for `find`.\n"
+          "  -f FORMAT     Set output format to FORMAT (`utf-8` or `cp`).\n"
+          "  -p CPPREFIX   Set codepoint prefix to CPPREFIX.\n"
+          "  -n            Do not output newline (`pick`).\n"
+          "  -V            Do not output VS-16 codepoints.\n"
+          "  -t TONE       Set default skin tone to TONE (`L`, `ML`, `M`, `MD`, or `D`).\n"
+          "\n"
+          "Arguments:\n"
+          "  NAME          jome server name\n"
+          "  CMD           Command (`pick`, `find`, `stats`, `watch`, `reload`,\n"
+          "                or `quit`)\n"
+          "  QUERY         Find query (`find` command)\n";
+}
 
-Params parseArgs(QCoreApplication& app)
+[[noreturn]] void cmdLineError(const std::string& msg)
 {
-    QCommandLineParser parser;
+    std::cerr << "Command-line error: " << msg << ".\n";
+    std::exit(1);
+}
 
-    parser.setApplicationDescription("Control jome");
-    parser.addHelpOption();
-    parser.addVersionOption();
-    parser.addPositionalArgument("SERVER-NAME", "jome server name", "NAME");
-    parser.addPositionalArgument("CMD", "Command (`pick` or `quit`)", "CMD");
-    parser.process(app);
+/*
+ * Parses the value `val` of the unsigned integer option `-optName`.
+ */
+unsigned int parseUIntOpt(const char optName, const std::string& val)
+{
+    if (val.empty() || !std::all_of(val.begin(), val.end(), [](const unsigned char ch) {
+        return std::isdigit(ch);
+    })) {
+        cmdLineError(std::string {"unexpected value for `-"} + optName + "`: `" + val + "`");
+    }
 
-    Params params;
-    const auto posArgs = parser.positionalArguments();
+    errno = 0;
 
-    if (posArgs.isEmpty()) {
-        std::cerr << "Command-line error: missing server name.\n";
-        std::exit(1);
+    const auto uintVal = std::strtoul(val.c_str(), nullptr, 10);
+
+    if (errno != 0 || uintVal > 0xffffffffUL) {
+        cmdLineError(std::string {"unexpected value for `-"} + optName + "`: `" + val + "`");
     }
 
-    params.serverName = parser.positionalArguments().first();
+    return static_cast<unsigned int>(uintVal);
+}
+
+/*
+ * Parses the command words `words` (`CMD [QUERY...]`, not empty) into
+ * `cmd` and `query`, returning an error message on error.
+ */
+std::optional<std::string> parseCmd(const std::vector<std::string>& words, Command& cmd,
+                                    std::string& query)
+{
+    const auto& name = words.front();
+
+    if (name == "pick") {
+        cmd = Command::Pick;
+    } else if (name == "quit") {
+        cmd = Command::Quit;
+    } else if (name == "stats") {
+        cmd = Command::Stats;
+    } else if (name == "watch") {
+        cmd = Command::Watch;
+    } else if (name == "reload") {
+        cmd = Command::Reload;
+    } else if (name == "find") {
+        cmd = Command::Find;
+
+        if (words.size() < 2) {
+            return "missing find query";
+        }
+
+        query.clear();
+
+        for (auto it = words.begin() + 1; it != words.end(); ++it) {
+            if (!query.empty()) {
+                query += ' ';
+            }
+
+            query += *it;
+        }
+    } else {
+        return "unknown command `" + name + "`";
+    }
+
+    return std::nullopt;
+}
+
+Params parseArgs(const int argc, char ** const argv)
+{
+    static const option longOpts[] = {
+        {"help", no_argument, nullptr, 'h'},
+        {"version", no_argument, nullptr, 'v'},
+        {"stdin", no_argument, nullptr, 'i'},
+        {nullptr, 0, nullptr, 0},
+    };
+
+    Params params;
+    bool defServer = false;
+
+    while (true) {
+        const auto opt = getopt_long(argc, argv, "hviDSw:l:f:p:nVt:", longOpts, nullptr);
+
+        if (opt == -1) {
+            break;
+        }
+
+        switch (opt) {
+        case 'h':
+            printUsage(std::cout);
+            std::exit(0);
+
+        case 'v':
+            std::cout << "jome-ctl " << JOME_VERSION << '\n';
+            std::exit(0);
+
+        case 'i':
+            params.fromStdin = true;
+            break;
+
+        case 'D':
+            defServer = true;
+            break;
+
+        case 'S':
+            params.spawnServer = true;
+            break;
+
+        case 'w':
+        {
+            const auto emojiWidth = parseUIntOpt('w', optarg);
+
+            if (emojiWidth != 16 && emojiWidth != 24 && emojiWidth != 32 &&
+                    emojiWidth != 40 && emojiWidth != 48) {
+                cmdLineError("unexpected value for `-w`: `" + std::to_string(emojiWidth) + "`");
+            }
+
+            params.emojiWidth = emojiWidth;
+            break;
+        }
+
+        case 'l':
+            params.limit = parseUIntOpt('l', optarg);
+            break;
+
+        case 'f':
+        {
+            const std::string fmt {optarg};
+
+            if (fmt != "utf-8" && fmt != "cp") {
+                cmdLineError("unknown format `" + fmt + "`");
+            }
+
+            params.optFields["fmt"] = fmt;
+            break;
+        }
+
+        case 'p':
+            params.optFields["cp-prefix"] = std::string {optarg};
+            break;
+
+        case 'n':
+            params.optFields["no-newline"] = std::uint64_t {1};
+            break;
+
+        case 'V':
+            params.optFields["no-vs16"] = std::uint64_t {1};
+            break;
 
-    if (posArgs.size() >= 2) {
-        auto& cmd = posArgs[1];
+        case 't':
+        {
+            std::string skinTone {optarg};
 
-        if (cmd == "quit") {
-            params.cmd = jome::QCtlClient::Command::Quit;
-        } else if (cmd != "pick") {
-            std::cerr << "Command-line error: unknown command `" <<
-                         cmd.toUtf8().constData() << "`.\n";
+            std::transform(skinTone.begin(), skinTone.end(), skinTone.begin(),
+                           [](const unsigned char ch) {
+                return static_cast<char>(std::toupper(ch));
+            });
+
+            if (skinTone != "L" && skinTone != "ML" && skinTone != "M" && skinTone != "MD" &&
+                    skinTone != "D") {
+                cmdLineError(std::string {"unexpected value for `-t`: `"} + optarg + "`");
+            }
+
+            params.optFields["skin-tone"] = skinTone;
+            break;
+        }
+
+        default:
+            // getopt_long() already printed a message
+            std::cerr << '\n';
+            printUsage(std::cerr);
             std::exit(1);
         }
     }
 
+    auto argIndex = optind;
+
+    if (defServer) {
+        params.serverName = jome::proto::defaultServerName();
+    } else {
+        if (argIndex >= argc) {
+            cmdLineError("missing server name");
+        }
+
+        params.serverName = argv[argIndex++];
+    }
+
+    if (params.fromStdin) {
+        if (argIndex < argc) {
+            cmdLineError("cannot specify a command with `--stdin`");
+        }
+
+        return params;
+    }
+
+    std::vector<std::string> words {argv + argIndex, argv + argc};
+
+    if (!words.empty()) {
+        if (const auto error = parseCmd(words, params.cmd, params.query)) {
+            cmdLineError(*error);
+        }
+    }
+
     return params;
 }
 
-} // namespace
+/*
+ * Returns the fields of a request for the command `cmd` with the find
+ * query `query` (`find` command) according to `params`.
+ */
+jome::proto::Fields requestFields(const Params& params, const Command cmd,
+                                  const std::string& query)
+{
+    auto fields = params.optFields;
+
+    switch (cmd) {
+    case Command::Pick:
+        fields["cmd"] = std::string {"pick"};
+
+        if (params.emojiWidth) {
+            fields["width"] = static_cast<std::uint64_t>(*params.emojiWidth);
+        }
+
+        break;
 
-int main(int argc, char **argv)
+    case Command::Find:
+        fields["cmd"] = std::string {"find"};
+        fields["query"] = query;
+
+        if (params.limit) {
+            fields["limit"] = static_cast<std::uint64_t>(*params.limit);
+        }
+
+        break;
+
+    case Command::Stats:
+        fields["cmd"] = std::string {"stats"};
+        break;
+
+    case Command::Watch:
+        fields["cmd"] = std::string {"subscribe"};
+        break;
+
+    case Command::Reload:
+        fields["cmd"] = std::string {"reload"};
+        break;
+
+    case Command::Quit:
+        fields["cmd"] = std::string {"quit"};
+        break;
+    }
+
+    return fields;
+}
+
+/*
+ * Starts `jome -s serverName` in the background, detached from this
+ * process, returning false if it can't execute `jome`.
+ */
+bool spawnServer(const std::string& serverName)
 {
-    QCoreApplication app {argc, argv};
+    // the server reports an `exec` error through this pipe
+    int pipeFds[2];
 
-    app.setApplicationName("jome-ctl");
-    app.setOrganizationName("jome");
-    app.setApplicationVersion(JOME_VERSION);
+    if (pipe2(pipeFds, O_CLOEXEC) < 0) {
+        return false;
+    }
+
+    const auto pid = fork();
+
+    if (pid < 0) {
+        close(pipeFds[0]);
+        close(pipeFds[1]);
+        return false;
+    }
 
-    const auto params = parseArgs(app);
-    jome::QCtlClient client {nullptr, params.serverName};
+    if (pid == 0) {
+        // intermediate child: new session, then orphan the server
+        close(pipeFds[0]);
+        setsid();
 
-    QObject::connect(&client, &jome::QCtlClient::serverReplied,
-                     [&params, &app](const QString& str) {
-        if (params.cmd == jome::QCtlClient::Command::Pick) {
-            std::cout << str.toStdString();
-            std::cout.flush();
+        const auto serverPid = fork();
+
+        if (serverPid != 0) {
+            if (serverPid < 0) {
+                const auto err = errno;
+
+                (void) !write(pipeFds[1], &err, sizeof err);
+            }
+
+            _exit(0);
         }
 
-        // ignore response for other commands, just quit
-        QTimer::singleShot(0, &app, &QCoreApplication::quit);
-    });
+        /*
+         * Server: don't inherit the standard input and output of the
+         * caller, which could be waiting for the end of our output.
+         */
+        if (const auto nullFd = open("/dev/null", O_RDWR); nullFd >= 0) {
+            dup2(nullFd, STDIN_FILENO);
+            dup2(nullFd, STDOUT_FILENO);
 
-    QObject::connect(&client, &jome::QCtlClient::serverCancelled, [&params, &app]() {
-        QTimer::singleShot(0, &app, [&params, &app] {
-            if (params.cmd == jome::QCtlClient::Command::Pick) {
-                app.exit(1);
-                return;
+            if (nullFd > STDOUT_FILENO) {
+                close(nullFd);
             }
+        }
+
+        execlp("jome", "jome", "-s", serverName.c_str(), nullptr);
 
-            app.exit(0);
-        });
-    });
+        const auto err = errno;
+
+        (void) !write(pipeFds[1], &err, sizeof err);
+        _exit(127);
+    }
 
-    QObject::connect(&client, &jome::QCtlClient::error, [&app]() {
-        // just quit
-        QTimer::singleShot(0, &app, [&app]() {
-            app.exit(1);
-        });
-    });
+    close(pipeFds[1]);
+    waitpid(pid, nullptr, 0);
+
+    // end of file: `exec` succeeded
+    int err;
+    ssize_t count;
+
+    do {
+        count = read(pipeFds[0], &err, sizeof err);
+    } while (count < 0 && errno == EINTR);
+
+    close(pipeFds[0]);
+    return count == 0;
+}
+
+/*
+ * Connects `client` to its server, starting the server first if needed
+ * and `params.spawnServer` is true.
+ */
+bool connectToServer(jome::proto::Client& client, const Params& params)
+{
+    using Client = jome::proto::Client;
+
+    if (client.connect()) {
+        return true;
+    }
+
+    if (!params.spawnServer || (client.error() != Client::Error::ServerNotFound &&
+                                client.error() != Client::Error::ConnectionRefused)) {
+        return false;
+    }
+
+    if (client.error() == Client::Error::ConnectionRefused) {
+        // nobody listens: stale socket file
+        unlink(jome::proto::serverSocketPath(params.serverName).c_str());
+    }
+
+    if (!spawnServer(params.serverName)) {
+        std::cerr << "Error: cannot start `jome`\n";
+        std::exit(1);
+    }
+
+    // retry, waiting a bit longer each time
+    const auto deadline = std::chrono::steady_clock::now() + maxSpawnWait;
+    unsigned int retryDelayMs = 10;
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds {retryDelayMs});
+
+        if (client.connect()) {
+            return true;
+        }
+
+        retryDelayMs = std::min(retryDelayMs * 2, maxRetryDelayMs);
+    }
+
+    return false;
+}
+
+/*
+ * Prints the events which `client` receives for the `subscribe`
+ * request `reqId` until the server quits, one line per event:
+ * `EVENT` or `accept<TAB>EMOJI<TAB>NAME`.
+ */
+int watch(jome::proto::Client& client, const std::uint32_t reqId)
+{
+    while (const auto frame = client.receive()) {
+        if (frame->type != jome::proto::FrameType::Event || frame->reqId != reqId) {
+            continue;
+        }
+
+        const auto event = frame->strField("event");
+
+        if (!event) {
+            continue;
+        }
+
+        if (const auto droppedCount = frame->uintField("dropped")) {
+            std::cout << "dropped\t" << *droppedCount << '\n';
+        }
+
+        std::cout << *event;
+
+        if (*event == "accept") {
+            const auto emoji = frame->strField("emoji");
+            const auto emojiName = frame->strField("name");
+
+            std::cout << '\t' << (emoji ? *emoji : "") << '\t' << (emojiName ? *emojiName : "");
+        }
+
+        std::cout << std::endl;
+    }
+
+    if (client.error() == jome::proto::Client::Error::Closed) {
+        // the server quit: done
+        return 0;
+    }
+
+    std::cerr << "Error: " << client.errorString() << '\n';
+    return 1;
+}
+
+/*
+ * Request sent with `--stdin`, waiting to be printed.
+ */
+struct StreamReq final
+{
+    // ID of the request
+    std::uint32_t reqId = 0;
+
+    Command cmd = Command::Pick;
+
+    // received reply, if any
+    std::optional<jome::proto::Frame> reply;
+
+    // command line error, instead of a request
+    std::optional<std::string> error;
+};
+
+/*
+ * Prints the reply of `req` like main() does, followed with an empty
+ * line, returning false if it's an error.
+ */
+bool printStreamReply(const StreamReq& req)
+{
+    auto ok = true;
+
+    if (req.error) {
+        std::cerr << "Error: " << *req.error << '\n';
+        ok = false;
+    } else if (const auto status = req.reply->uintField("status");
+               status == static_cast<std::uint64_t>(jome::proto::ReplyStatus::Ok)) {
+        if (const auto output = req.reply->strField("output");
+                output && !output->empty() && req.cmd != Command::Quit) {
+            std::cout << *output;
+
+            if (output->back() != '\n') {
+                std::cout << '\n';
+            }
+        }
+    } else if (status != static_cast<std::uint64_t>(jome::proto::ReplyStatus::Cancelled)) {
+        const auto msg = req.reply->strField("error");
+
+        std::cerr << "Error: " << (msg ? *msg : "unknown error") << '\n';
+        ok = false;
+    }
+
+    // end of reply
+    std::cout << std::endl;
+    return ok;
+}
+
+/*
+ * Reads commands (`CMD [QUERY...]`), one per line, from the standard
+ * input and sends their requests to the server through `client`
+ * without waiting for the previous replies.
+ *
+ * Prints the replies in the order of the commands, each one followed
+ * with an empty line.
+ *
+ * Returns the exit code: 1 if any command fails.
+ */
+int stream(jome::proto::Client& client, const Params& params)
+{
+    std::deque<StreamReq> reqs;
+    std::string inData;
+    auto inEof = false;
+    auto quitSent = false;
+    auto exitCode = 0;
+
+    // sends the request of the command line `line`, if any
+    const auto sendLine = [&client, &params, &reqs, &quitSent](const std::string& line) {
+        std::istringstream lineStream {line};
+        std::vector<std::string> words;
+        std::string word;
+
+        while (lineStream >> word) {
+            words.push_back(std::move(word));
+        }
+
+        if (words.empty()) {
+            return true;
+        }
+
+        StreamReq req;
+        std::string query;
+
+        req.error = parseCmd(words, req.cmd, query);
+
+        if (!req.error && req.cmd == Command::Watch) {
+            req.error = "cannot watch with `--stdin`";
+        }
+
+        if (!req.error) {
+            const auto reqId = client.sendRequest(requestFields(params, req.cmd, query));
+
+            if (!reqId) {
+                return false;
+            }
+
+            req.reqId = *reqId;
+
+            if (req.cmd == Command::Quit) {
+                // the server closes the connection afterwards
+                quitSent = true;
+            }
+        }
+
+        reqs.push_back(std::move(req));
+        return true;
+    };
+
+    /*
+     * Sends the complete buffered command lines while fewer than
+     * `maxPendingReqCount` requests are in flight, stopping
+     * after `quit`.
+     */
+    const auto sendLines = [&inData, &reqs, &quitSent, &sendLine] {
+        std::string::size_type nlPos;
+
+        while (!quitSent && reqs.size() < maxPendingReqCount &&
+                (nlPos = inData.find('\n')) != std::string::npos) {
+            const auto line = inData.substr(0, nlPos);
+
+            inData.erase(0, nlPos + 1);
+
+            if (!sendLine(line)) {
+                return false;
+            }
+        }
+
+        return true;
+    };
+
+    while (true) {
+        // send the buffered commands and print the ready replies, in order
+        while (true) {
+            if (!sendLines()) {
+                std::cerr << "Error: " << client.errorString() << '\n';
+                return 1;
+            }
+
+            if (reqs.empty() || !(reqs.front().error || reqs.front().reply)) {
+                break;
+            }
+
+            while (!reqs.empty() && (reqs.front().error || reqs.front().reply)) {
+                if (!printStreamReply(reqs.front())) {
+                    exitCode = 1;
+                }
+
+                reqs.pop_front();
+            }
+        }
+
+        // no more commands: only the sent ones remain
+        const auto inDone = quitSent || (inEof && inData.find('\n') == std::string::npos);
+
+        if (inDone && reqs.empty()) {
+            return exitCode;
+        }
+
+        // don't read more commands while too many requests are in flight
+        const auto readIn = !inDone && !inEof && reqs.size() < maxPendingReqCount;
+        pollfd pollFds[] = {{client.fd(), POLLIN, 0}, {STDIN_FILENO, POLLIN, 0}};
+
+        if (poll(pollFds, readIn ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            std::cerr << "Error: cannot poll: " << std::strerror(errno) << '\n';
+            return 1;
+        }
+
+        if (pollFds[0].revents != 0) {
+            // all the frames available now
+            while (auto frame = client.receive(0)) {
+                if (frame->type != jome::proto::FrameType::Reply) {
+                    continue;
+                }
+
+                for (auto& req : reqs) {
+                    if (!req.error && req.reqId == frame->reqId) {
+                        req.reply = std::move(*frame);
+                        break;
+                    }
+                }
+            }
+
+            if (client.error() == jome::proto::Client::Error::Closed && quitSent &&
+                    std::all_of(reqs.begin(), reqs.end(), [](const StreamReq& req) {
+                        return req.error || req.reply;
+                    })) {
+                // expected after `quit`: print the remaining replies
+                continue;
+            }
+
+            if (client.error() != jome::proto::Client::Error::Timeout) {
+                std::cerr << "Error: " << client.errorString() << '\n';
+                return 1;
+            }
+        }
+
+        if (readIn && pollFds[1].revents != 0) {
+            char buf[4096];
+            const auto count = read(STDIN_FILENO, buf, sizeof buf);
+
+            if (count < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+
+                std::cerr << "Error: cannot read the standard input: " <<
+                             std::strerror(errno) << '\n';
+                return 1;
+            }
+
+            if (count == 0) {
+                // last line without a newline
+                inEof = true;
+                inData += '\n';
+            } else {
+                inData.append(buf, static_cast<std::size_t>(count));
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(const int argc, char ** const argv)
+{
+    const auto params = parseArgs(argc, argv);
+    jome::proto::Client client {params.serverName};
+
+    if (!connectToServer(client, params)) {
+        std::cerr << "Error: " << client.errorString() << '\n';
+        return 1;
+    }
+
+    if (params.fromStdin) {
+        return stream(client, params);
+    }
+
+    // the user takes as long as they want to pick
+    const auto reply = client.request(requestFields(params, params.cmd, params.query),
+                                      params.cmd == Command::Pick ||
+                                      params.cmd == Command::Watch ?
+                                      std::nullopt : std::make_optional(replyTimeoutMs));
+
+    if (!reply) {
+        std::cerr << "Error: " << client.errorString() << '\n';
+        return 1;
+    }
+
+    const auto status = reply->uintField("status");
+
+    if (status == static_cast<std::uint64_t>(jome::proto::ReplyStatus::Ok)) {
+        if (params.cmd == Command::Watch) {
+            // subscribed: wait for events
+            return watch(client, reply->reqId);
+        }
+
+        // print the output of `pick`, `find`, and `stats`
+        if (params.cmd != Command::Quit) {
+            if (const auto output = reply->strField("output")) {
+                std::cout << *output;
+                std::cout.flush();
+            }
+        }
+
+        return 0;
+    } else if (status == static_cast<std::uint64_t>(jome::proto::ReplyStatus::Cancelled)) {
+        return params.cmd == Command::Pick ? 1 : 0;
+    }
+
+    if (const auto msg = reply->strField("error")) {
+        std::cerr << "Error: " << *msg << '\n';
+    }
 
-    client.ctl(params.cmd);
-    return app.exec();
+    return 1;
 }
@@ -0,0 +1,59 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include "client.hpp"
+#include "delegate.hpp"
+
+namespace jome {
+
+std::optional<DelegatedPickReply> delegatePick(const QString& serverName,
+                                               const proto::Fields& fields,
+                                               const unsigned int handshakeTimeoutMs)
+{
+    proto::Client client {serverName.toStdString()};
+
+    if (!client.connect()) {
+        // no server
+        return std::nullopt;
+    }
+
+    // a wedged or v1 server never replies to the handshake
+    if (!client.handshake(handshakeTimeoutMs)) {
+        return std::nullopt;
+    }
+
+    auto reqFields = fields;
+
+    reqFields["cmd"] = std::string {"pick"};
+
+    // wait for the reply, as long as the user picks
+    const auto reply = client.request(reqFields);
+
+    if (!reply) {
+        return DelegatedPickReply {false, {}, QString::fromStdString(client.errorString())};
+    }
+
+    const auto status = reply->uintField("status");
+
+    if (status == static_cast<std::uint64_t>(proto::ReplyStatus::Ok)) {
+        const auto output = reply->strField("output");
+
+        return DelegatedPickReply {
+            false, output ? QString::fromStdString(*output) : QString {}, std::nullopt
+        };
+    } else if (status == static_cast<std::uint64_t>(proto::ReplyStatus::Cancelled)) {
+        return DelegatedPickReply {true, {}, std::nullopt};
+    }
+
+    const auto msg = reply->strField("error");
+
+    return DelegatedPickReply {
+        false, {}, msg ? QString::fromStdString(*msg) : QString {"unexpected reply"}
+    };
+}
+
+} // namespace jome
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_DELEGATE_HPP
+#define _JOME_DELEGATE_HPP
+
+#include <QString>
+#include <optional>
+
+#include "proto.hpp"
+
+namespace jome {
+
+/*
+ * Reply of a jome server to a delegated `pick` request.
+ */
+struct DelegatedPickReply final
+{
+    // true if the user cancelled
+    bool cancelled;
+
+    // formatted emoji (if not cancelled)
+    QString output;
+
+    // reason if the server failed or the connection broke
+    std::optional<QString> error;
+};
+
+/*
+ * Sends a `pick` request with the option fields `fields` to the jome
+ * server named `serverName` and waits for its reply, as long as the
+ * user picks.
+ *
+ * Returns `std::nullopt` if no server listens or if the server doesn't
+ * complete the v2 handshake within `handshakeTimeoutMs` milliseconds
+ * (older or unresponsive server): the caller may then pick an emoji by
+ * itself.
+ *
+ * Once the server accepted the request, the server may already show its
+ * window: if the server replies with an error or if the connection
+ * breaks, then the returned reply contains an error instead.
+ */
+std::optional<DelegatedPickReply> delegatePick(const QString& serverName,
+                                               const proto::Fields& fields,
+                                               unsigned int handshakeTimeoutMs = 300);
+
+} // namespace jome
+
+#endif // _JOME_DELEGATE_HPP
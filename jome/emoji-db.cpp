@@ -10,6 +10,7 @@
 #include <fstream>
 #include <cstdlib>
 #include <cassert>
+#include <stdexcept>
 #include <QString>
 #include <QRegularExpression>
 #include <QStandardPaths>
@@ -140,17 +141,72 @@ EmojiCat::EmojiCat(QString id, QString name) :
 {
 }
 
-EmojiDb::EmojiDb(const QString& dir, const EmojiSize emojiSize,
-                 const unsigned int maxRecentEmojis, const bool noRecentCat,
-                 const bool incRecentInFindResults) :
-    _emojiSize {emojiSize},
-    _emojisPngPath {qFmtFormat("{}/emojis-{}.png", dir.toStdString(), this->emojiSizeInt())},
+EmojiDb::EmojiDb(const QString& dir, const unsigned int maxRecentEmojis,
+                 const bool noRecentCat, const bool incRecentInFindResults,
+                 const bool orderRecentByUsage, const bool strictUserEmojis) :
+    _dir {dir},
     _maxRecentEmojis {maxRecentEmojis},
-    _incRecentInFindResults {incRecentInFindResults}
+    _incRecentInFindResults {incRecentInFindResults},
+    _orderRecentByUsage {orderRecentByUsage}
 {
     this->_createEmojis(dir);
     this->_createCats(dir, noRecentCat);
-    this->_createEmojiPngLocations(dir);
+    this->userKeywords(this->loadUserKeywords(strictUserEmojis));
+}
+
+QString EmojiDb::userEmojisJsonPath()
+{
+    return qFmtFormat("{}/{}",
+                      QStandardPaths::standardLocations(QStandardPaths::ConfigLocation).first().toStdString(),
+                      "jome/emojis.json");
+}
+
+QStringList EmojiDb::dataFilePaths(const QString& dir)
+{
+    return {
+        qFmtFormat("{}/emojis.json", dir.toStdString()),
+        qFmtFormat("{}/cats.json", dir.toStdString()),
+    };
+}
+
+std::optional<EmojiDb::EmojiSize> EmojiDb::emojiSizeFromInt(const unsigned int sizeInt) noexcept
+{
+    switch (sizeInt) {
+    case 16:
+        return EmojiSize::Size16;
+
+    case 24:
+        return EmojiSize::Size24;
+
+    case 32:
+        return EmojiSize::Size32;
+
+    case 40:
+        return EmojiSize::Size40;
+
+    case 48:
+        return EmojiSize::Size48;
+
+    default:
+        return std::nullopt;
+    }
+}
+
+QString EmojiDb::emojisPngPath(const EmojiSize emojiSize) const
+{
+    return qFmtFormat("{}/emojis-{}.png", _dir.toStdString(), emojiSizeInt(emojiSize));
+}
+
+const EmojisPngLocations& EmojiDb::emojiPngLocations(const EmojiSize emojiSize) const
+{
+    auto it = _emojiPngLocations.find(emojiSize);
+
+    if (it == _emojiPngLocations.end()) {
+        // first time: load
+        it = _emojiPngLocations.emplace(emojiSize, this->_loadEmojiPngLocations(emojiSize)).first;
+    }
+
+    return it->second;
 }
 
 namespace {
@@ -188,143 +244,111 @@ void warnNoUserEmojiKeywords(const QString& path, const QString& msg)
 }
 
 /*
- * Loads the user-defined emoji keywords, validates the JSON object,
- * and returns it or an empty object if invalid.
+ * Validates the user-defined emoji keywords `jsonUserEmojis`, returning
+ * the reason if invalid.
  */
-nlohmann::json loadUserEmojisJson()
+std::optional<QString> userEmojisJsonError(const nlohmann::json& jsonUserEmojis)
 {
-    const auto path = qFmtFormat("{}/{}",
-                                 QStandardPaths::standardLocations(QStandardPaths::ConfigLocation).first().toStdString(),
-                                 "jome/emojis.json");
-
-    if (!QFile::exists(path)) {
-        // this is an optional file
-        return nlohmann::json::object();
-    }
-
-    auto jsonUserEmojis = std::invoke([&path]() -> std::optional<nlohmann::json> {
-        try {
-            return loadJson(path);
-        } catch (const nlohmann::json::exception& exc) {
-            warnNoUserEmojiKeywords(path, qFmtFormat("failed to load JSON file: {}", exc.what()));
-            return std::nullopt;
-        }
-    });
-
-    if (!jsonUserEmojis) {
-        return nlohmann::json::object();
-    }
-
-    // validate
-    if (!jsonUserEmojis->is_object()) {
-        warnNoUserEmojiKeywords(path, "expecting a root JSON object");
-        return nlohmann::json::object();
+    if (!jsonUserEmojis.is_object()) {
+        return "expecting a root JSON object";
     }
 
-    for (const auto& keyJsonValPair : jsonUserEmojis->items()) {
+    for (const auto& keyJsonValPair : jsonUserEmojis.items()) {
         if (!keyJsonValPair.value().is_object()) {
-            warnNoUserEmojiKeywords(path, qFmtFormat("emoji `{}`: expecting an object",
-                                                     keyJsonValPair.key()));
-            return nlohmann::json::object();
+            return qFmtFormat("emoji `{}`: expecting an object", keyJsonValPair.key());
         }
 
-        const auto validateKeywords = [&keyJsonValPair, &path](const std::string& key) {
+        const auto keywordsError = [&keyJsonValPair](const std::string& key) -> std::optional<QString> {
             const auto it = keyJsonValPair.value().find(key);
 
             if (it == keyJsonValPair.value().end()) {
-                return true;
+                return std::nullopt;
             }
 
             if (!it->is_array()) {
-                warnNoUserEmojiKeywords(path, qFmtFormat("emoji `{}`: `{}`: expecting an array",
-                                                         keyJsonValPair.key(), key));
-                return false;
+                return qFmtFormat("emoji `{}`: `{}`: expecting an array",
+                                  keyJsonValPair.key(), key);
             }
 
             for (const auto& jsonKeyword : *it) {
                 if (!jsonKeyword.is_string()) {
-                    warnNoUserEmojiKeywords(path, qFmtFormat("emoji `{}`: `{}`: expecting an array of strings",
-                                                             keyJsonValPair.key(), key));
-                    return false;
+                    return qFmtFormat("emoji `{}`: `{}`: expecting an array of strings",
+                                      keyJsonValPair.key(), key);
                 }
             }
 
-            return true;
+            return std::nullopt;
         };
 
-        if (!validateKeywords("keywords")) {
-            return nlohmann::json::object();
+        if (auto error = keywordsError("keywords")) {
+            return error;
         }
 
-        if (!validateKeywords("extra-keywords")) {
-            return nlohmann::json::object();
+        if (auto error = keywordsError("extra-keywords")) {
+            return error;
         }
     }
 
-    return *jsonUserEmojis;
+    return std::nullopt;
 }
 
 /*
- * Returns a set of strings from the JSON array of JSON
- * strings `jsonArray`.
+ * Loads the user-defined emoji keywords, validates the JSON object,
+ * and returns it.
+ *
+ * If the user-defined emoji keywords are invalid, then throws
+ * `std::runtime_error` if `strict` is true, or warns and returns an
+ * empty object otherwise.
  */
-std::unordered_set<QString> qStrSetFromJsonStrArray(const nlohmann::json& jsonArray)
+nlohmann::json loadUserEmojisJson(const bool strict)
 {
-    assert(jsonArray.is_array());
-
-    std::unordered_set<QString> set;
+    const auto path = EmojiDb::userEmojisJsonPath();
 
-    for (auto& jsonStr : jsonArray) {
-        assert(jsonStr.is_string());
-        set.insert(QString::fromStdString(jsonStr));
+    if (!QFile::exists(path)) {
+        // this is an optional file
+        return nlohmann::json::object();
     }
 
-    return set;
-}
+    nlohmann::json jsonUserEmojis;
+    std::optional<QString> error;
 
-/*
- * Returns the set of effective emoji keywords of the emoji having the
- * string `emojiStr` given:
- *
- * • The built-in keywords `jsonKeywords`.
- *
- * • The user-defined emoji keywords `jsonUserEmojis` (the
- *   whole object).
- */
-std::unordered_set<QString> effectiveEmojiKeywords(const QString& emojiStr,
-                                                   const nlohmann::json& jsonKeywords,
-                                                   const nlohmann::json& jsonUserEmojis)
-{
-    auto jsonUserKeywords = nlohmann::json::array();
-    auto jsonUserExtraKeywords = nlohmann::json::array();
+    try {
+        jsonUserEmojis = loadJson(path);
+        error = userEmojisJsonError(jsonUserEmojis);
+    } catch (const nlohmann::json::exception& exc) {
+        error = qFmtFormat("failed to load JSON file: {}", exc.what());
+    }
 
-    if (const auto it = jsonUserEmojis.find(emojiStr.toStdString()); it != jsonUserEmojis.end()) {
-        if (const auto jsonKeywordsIt = it->find("keywords"); jsonKeywordsIt != it->end()) {
-            jsonUserKeywords = *jsonKeywordsIt;
-        }
+    if (!error) {
+        return jsonUserEmojis;
+    }
 
-        if (const auto jsonKeywordsIt = it->find("extra-keywords"); jsonKeywordsIt != it->end()) {
-            jsonUserExtraKeywords = *jsonKeywordsIt;
-        }
+    if (strict) {
+        throw std::runtime_error {
+            qFmtFormat("{}: {}", path.toStdString(), error->toStdString()).toStdString()
+        };
     }
 
-    std::unordered_set<QString> keywords;
+    warnNoUserEmojiKeywords(path, *error);
+    return nlohmann::json::object();
+}
 
-    if (jsonUserKeywords.empty()) {
-        // start with default keywords
-        keywords = qStrSetFromJsonStrArray(jsonKeywords);
-    } else {
-        // start with user keywords
-        keywords = qStrSetFromJsonStrArray(jsonUserKeywords);
-    }
+/*
+ * Returns a set of strings from the JSON array of JSON
+ * strings `jsonArray`.
+ */
+std::unordered_set<QString> qStrSetFromJsonStrArray(const nlohmann::json& jsonArray)
+{
+    assert(jsonArray.is_array());
 
-    {
-        const auto userExtraKeywords = qStrSetFromJsonStrArray(jsonUserExtraKeywords);
+    std::unordered_set<QString> set;
 
-        keywords.insert(userExtraKeywords.begin(), userExtraKeywords.end());
+    for (auto& jsonStr : jsonArray) {
+        assert(jsonStr.is_string());
+        set.insert(QString::fromStdString(jsonStr));
     }
 
-    return keywords;
+    return set;
 }
 
 } // namespace
@@ -334,20 +358,15 @@ void EmojiDb::_createEmojis(const QString& dir)
     // load jome's emoji database
     const auto jsonEmojis = loadJson(dir, "emojis.json");
 
-    // load user-defined emoji keywords
-    const auto jsonUserEmojis = loadUserEmojisJson();
-
     // build each emoji object
     for (auto& emojiKeyJsonValPair : jsonEmojis.items()) {
-        auto emoji = std::invoke([&emojiKeyJsonValPair, &jsonUserEmojis] {
+        auto emoji = std::invoke([&emojiKeyJsonValPair] {
             const auto emojiStr = QString::fromStdString(emojiKeyJsonValPair.key());
             auto& jsonVal = emojiKeyJsonValPair.value();
 
             return std::make_unique<const Emoji>(emojiStr,
                                                  QString::fromStdString(jsonVal.at("name")),
-                                                 effectiveEmojiKeywords(emojiStr,
-                                                                        jsonVal.at("keywords"),
-                                                                        jsonUserEmojis),
+                                                 qStrSetFromJsonStrArray(jsonVal.at("keywords")),
                                                  std::invoke([&jsonVal] {
                                                      std::unordered_set<unsigned int> indexes;
 
@@ -432,19 +451,30 @@ void EmojiDb::_createCats(const QString& dir, const bool noRecentCat)
     }
 }
 
-void EmojiDb::_createEmojiPngLocations(const QString& dir)
+EmojisPngLocations EmojiDb::_loadEmojiPngLocations(const EmojiSize emojiSize) const
 {
     // load jome's PNG locations
-    const auto pngLocationsJson = loadJson(dir,
-                                           qFmtFormat("emojis-png-locations-{}.json", this->emojiSizeInt()));
+    const auto pngLocationsJson = loadJson(_dir,
+                                           qFmtFormat("emojis-png-locations-{}.json",
+                                                      emojiSizeInt(emojiSize)));
 
     // assign each emoji to its PNG location
+    EmojisPngLocations locations;
+
     for (auto& [key, jsonLoc] : pngLocationsJson.items()) {
-        _emojiPngLocations[_emojis[QString::fromStdString(key)].get()] = {
+        const auto it = _emojis.find(QString::fromStdString(key));
+
+        if (it == _emojis.end()) {
+            continue;
+        }
+
+        locations[it->second.get()] = {
             static_cast<unsigned int>(jsonLoc.at(0)),
             static_cast<unsigned int>(jsonLoc.at(1))
         };
     }
+
+    return locations;
 }
 
 void EmojiDb::findEmojis(QString catName, const QString& needlesStr,
@@ -456,9 +486,15 @@ void EmojiDb::findEmojis(QString catName, const QString& needlesStr,
     // trim category
     catName = catName.trimmed();
 
-    // clear temporary results
-    _tmpFindResults.clear();
-    _tmpFindResultEmojis.clear();
+    // local to be reentrant
+    std::set<_FindResult> findResults;
+    std::set<const Emoji *> findResultEmojis;
+
+    // the "Recent" category may change from another thread
+    std::shared_lock<std::shared_mutex> lock {_recentEmojisMutex};
+
+    // keep the user-defined keywords while finding
+    const auto userKeywords = std::atomic_load(&_userKeywords);
 
     // handle specific codepoint search
     if (needles.size() == 1 && needles.first().size() >= 3 && needles.first().startsWith("u+")) {
@@ -480,9 +516,9 @@ void EmojiDb::findEmojis(QString catName, const QString& needlesStr,
 
             for (auto emoji : cat->emojis()) {
                 if (emoji->codepointStr().contains(needles.first()) &&
-                        _tmpFindResultEmojis.count(emoji) == 0) {
+                        findResultEmojis.count(emoji) == 0) {
                     results.push_back(emoji);
-                    _tmpFindResultEmojis.insert(emoji);
+                    findResultEmojis.insert(emoji);
                 }
             }
         }
@@ -490,6 +526,19 @@ void EmojiDb::findEmojis(QString catName, const QString& needlesStr,
         return;
     }
 
+    // learned picks for those terms, if any
+    std::unordered_map<const Emoji *, double> pickScores;
+
+    if (const auto picks = _pickAffinity.picks(needlesStr.toLower().simplified().toStdString())) {
+        const auto now = UsageStore<const Emoji *>::Clock::now();
+
+        for (const auto& [emoji, pickScore] : picks->scores()) {
+            if (picks->count(emoji, now) >= _minPinnedPickCount) {
+                pickScores[emoji] = pickScore;
+            }
+        }
+    }
+
     auto pos = 0U;
 
     for (auto& cat : _cats) {
@@ -514,6 +563,7 @@ void EmojiDb::findEmojis(QString catName, const QString& needlesStr,
         }
 
         for (auto emoji : cat->emojis()) {
+            const auto& keywords = EmojiDb::_keywords(*emoji, userKeywords.get());
             auto score = initScore;
 
             for (auto& needle : needles) {
@@ -529,7 +579,7 @@ void EmojiDb::findEmojis(QString catName, const QString& needlesStr,
 
                 auto addToNeedleScore = 0U;
 
-                for (auto& keyword : emoji->keywords()) {
+                for (auto& keyword : keywords) {
                     if (keyword == needle) {
                         addToNeedleScore = 40;
                         break;
@@ -553,9 +603,14 @@ void EmojiDb::findEmojis(QString catName, const QString& needlesStr,
             }
 
             if (needles.isEmpty() || score > 0) {
-                if (_tmpFindResultEmojis.count(emoji) == 0) {
-                    _tmpFindResults.insert({score, pos, emoji});
-                    _tmpFindResultEmojis.insert(emoji);
+                if (findResultEmojis.count(emoji) == 0) {
+                    const auto pickScoreIt = pickScores.find(emoji);
+
+                    findResults.insert({
+                        pickScoreIt == pickScores.end() ? 0. : pickScoreIt->second,
+                        score, _usage.score(emoji), pos, emoji
+                    });
+                    findResultEmojis.insert(emoji);
                 }
             }
 
@@ -563,53 +618,218 @@ void EmojiDb::findEmojis(QString catName, const QString& needlesStr,
         }
     }
 
-    for (auto it = _tmpFindResults.crbegin(); it != _tmpFindResults.crend(); ++it) {
+    for (auto it = findResults.crbegin(); it != findResults.crend(); ++it) {
         results.push_back(it->emoji);
     }
 }
 
-void EmojiDb::recentEmojis(std::vector<const Emoji *>&& emojis)
+void EmojiDb::findEmojis(const QString& query, std::vector<const Emoji *>& results) const
 {
-    if (!_recentEmojisCat) {
-        // no "Recent" category: return
+    const auto parts = query.split("/");
+
+    if (parts.size() != 2) {
+        this->findEmojis("", query, results);
         return;
     }
 
-    _recentEmojisCat->emojis() = std::move(emojis);
+    this->findEmojis(parts[0], parts[1], results);
+}
+
+QString EmojiDb::findTerms(const QString& query)
+{
+    const auto parts = query.split("/");
 
-    if (_recentEmojisCat->emojis().size() > _maxRecentEmojis) {
+    return (parts.size() == 2 ? parts[1] : query).toLower().simplified();
+}
+
+bool EmojiDb::_updateRecentEmojisCat()
+{
+    auto& byRecency = _recentEmojisByRecency;
+
+    if (byRecency.size() > _maxRecentEmojis) {
         // clip
-        _recentEmojisCat->emojis().resize(_maxRecentEmojis);
+        byRecency.resize(_maxRecentEmojis);
     }
+
+    auto emojis = byRecency;
+
+    if (_orderRecentByUsage) {
+        // most used first, then most recent first
+        std::stable_sort(emojis.begin(), emojis.end(), [this](const auto a, const auto b) {
+            return _usage.score(a) > _usage.score(b);
+        });
+    }
+
+    if (emojis == _recentEmojisCat->emojis()) {
+        return false;
+    }
+
+    _recentEmojisCat->emojis() = std::move(emojis);
+    return true;
 }
 
-void EmojiDb::addRecentEmoji(const Emoji& emoji)
+bool EmojiDb::recentEmojis(std::vector<const Emoji *>&& emojis, UsageStore<const Emoji *>&& usage,
+                           PickAffinity<const Emoji *>&& affinity)
+{
+    if (!_recentEmojisCat) {
+        // no "Recent" category: return
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> lock {_recentEmojisMutex};
+
+    _recentEmojisByRecency = std::move(emojis);
+    _usage = std::move(usage);
+    _pickAffinity = std::move(affinity);
+    return this->_updateRecentEmojisCat();
+}
+
+void EmojiDb::addRecentEmoji(const Emoji& emoji, const QString& findTerms)
 {
     if (!_recentEmojisCat) {
         // no "Recent" category: return
         return;
     }
 
-    auto& emojis = _recentEmojisCat->emojis();
+    std::unique_lock<std::shared_mutex> lock {_recentEmojisMutex};
+    auto& byRecency = _recentEmojisByRecency;
+
+    // remove from current list and insert at the beginning
+    byRecency.erase(std::remove(byRecency.begin(), byRecency.end(), &emoji), byRecency.end());
+    byRecency.insert(byRecency.begin(), &emoji);
+    _usage.add(&emoji);
+
+    for (const auto& prefix : PickAffinity<const Emoji *>::prefixes(findTerms.toStdString())) {
+        _pickAffinity.add(prefix, &emoji);
+    }
+
+    this->_updateRecentEmojisCat();
+}
+
+const Emoji *EmojiDb::_sameEmoji(const Emoji& emoji) const
+{
+    const auto it = _emojis.find(emoji.str());
 
-    // remove from current list
-    while (true) {
-        auto existingIt = std::find(emojis.begin(), emojis.end(), &emoji);
+    return it == _emojis.end() ? nullptr : it->second.get();
+}
+
+bool EmojiDb::copyRecentEmojis(const EmojiDb& otherDb)
+{
+    if (!_recentEmojisCat) {
+        // no "Recent" category: return
+        return false;
+    }
 
-        if (existingIt == emojis.end()) {
-            break;
+    std::shared_lock<std::shared_mutex> otherLock {otherDb._recentEmojisMutex};
+    std::unique_lock<std::shared_mutex> lock {_recentEmojisMutex};
+
+    _recentEmojisByRecency.clear();
+
+    for (const auto otherEmoji : otherDb._recentEmojisByRecency) {
+        if (const auto emoji = this->_sameEmoji(*otherEmoji)) {
+            _recentEmojisByRecency.push_back(emoji);
         }
+    }
 
-        emojis.erase(existingIt);
+    // same reference times and half-lives: copy the scores as is
+    const auto& otherUsage = otherDb._usage;
+
+    _usage = UsageStore<const Emoji *> {
+        otherUsage.maxSize(), otherUsage.halfLife(), otherUsage.refTime()
+    };
+
+    for (const auto& [otherEmoji, score] : otherUsage.scores()) {
+        if (const auto emoji = this->_sameEmoji(*otherEmoji)) {
+            _usage.score(emoji, score);
+        }
     }
 
-    // insert at the beginning
-    emojis.insert(emojis.begin(), &emoji);
+    const auto& otherAffinity = otherDb._pickAffinity;
 
-    if (emojis.size() > _maxRecentEmojis) {
-        // clip
-        emojis.resize(_maxRecentEmojis);
+    _pickAffinity = PickAffinity<const Emoji *> {
+        otherAffinity.maxPrefixCount(), otherAffinity.maxPicksPerPrefix(),
+        otherAffinity.halfLife(), otherAffinity.refTime()
+    };
+
+    for (const auto& [prefix, picks] : otherAffinity.picks()) {
+        for (const auto& [otherEmoji, score] : picks.scores()) {
+            if (const auto emoji = this->_sameEmoji(*otherEmoji)) {
+                _pickAffinity.addScore(prefix, emoji, score);
+            }
+        }
+    }
+
+    return this->_updateRecentEmojisCat();
+}
+
+std::shared_ptr<const EmojiDb::UserKeywords> EmojiDb::loadUserKeywords(const bool strict) const
+{
+    const auto jsonUserEmojis = loadUserEmojisJson(strict);
+
+    if (jsonUserEmojis.empty()) {
+        return nullptr;
+    }
+
+    // only the emojis which the user emoji keyword file mentions
+    auto userKeywords = std::make_shared<UserKeywords>();
+
+    for (auto& [emojiStr, jsonUserEmoji] : jsonUserEmojis.items()) {
+        const auto it = _emojis.find(QString::fromStdString(emojiStr));
+
+        if (it == _emojis.end()) {
+            // unknown emoji
+            continue;
+        }
+
+        std::unordered_set<QString> keywords;
+
+        if (const auto jsonKeywordsIt = jsonUserEmoji.find("keywords");
+                jsonKeywordsIt != jsonUserEmoji.end() && !jsonKeywordsIt->empty()) {
+            // start with user keywords
+            keywords = qStrSetFromJsonStrArray(*jsonKeywordsIt);
+        } else {
+            // start with default keywords
+            keywords = it->second->keywords();
+        }
+
+        if (const auto jsonKeywordsIt = jsonUserEmoji.find("extra-keywords");
+                jsonKeywordsIt != jsonUserEmoji.end()) {
+            const auto userExtraKeywords = qStrSetFromJsonStrArray(*jsonKeywordsIt);
+
+            keywords.insert(userExtraKeywords.begin(), userExtraKeywords.end());
+        }
+
+        userKeywords->emplace(it->second.get(), std::move(keywords));
+    }
+
+    if (userKeywords->empty()) {
+        return nullptr;
+    }
+
+    return userKeywords;
+}
+
+void EmojiDb::userKeywords(std::shared_ptr<const UserKeywords> userKeywords)
+{
+    std::atomic_store(&_userKeywords, std::move(userKeywords));
+}
+
+const std::unordered_set<QString>& EmojiDb::_keywords(const Emoji& emoji,
+                                                      const UserKeywords * const userKeywords)
+{
+    if (userKeywords) {
+        if (const auto it = userKeywords->find(&emoji); it != userKeywords->end()) {
+            return it->second;
+        }
     }
+
+    return emoji.keywords();
+}
+
+const std::unordered_set<QString>& EmojiDb::keywords(const Emoji& emoji) const
+{
+    // the GUI thread is the only one which replaces them
+    return EmojiDb::_keywords(emoji, _userKeywords.get());
 }
 
 } // namespace jome
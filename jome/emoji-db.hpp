@@ -14,9 +14,14 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <set>
+#include <shared_mutex>
 #include <QString>
+#include <QStringList>
 #include <nlohmann/json.hpp>
 
+#include "pick-affinity.hpp"
+#include "usage-store.hpp"
+
 namespace jome {
 
 /*
@@ -138,7 +143,9 @@ public:
     }
 
     /*
-     * Keywords of this emoji.
+     * Built-in keywords of this emoji.
+     *
+     * See EmojiDb::keywords() to get its effective keywords.
      */
     const std::unordered_set<QString>& keywords() const noexcept
     {
@@ -262,6 +269,11 @@ struct EmojisPngLocation final
     unsigned int y;
 };
 
+/*
+ * Map of emojis to PNG locations.
+ */
+using EmojisPngLocations = std::unordered_map<const Emoji *, EmojisPngLocation>;
+
 /*
  * An emoji database.
  *
@@ -274,14 +286,44 @@ struct EmojisPngLocation final
  * string with hasEmoji().
  *
  * An emoji database also provides emoji images as locations within a
- * PNG images containing all the emoji images. Use emojiSizeInt(),
- * emojisPngPath(), and emojiPngLocations().
+ * PNG images containing all the emoji images, one PNG image per
+ * supported emoji size. Use emojisPngPath() and emojiPngLocations():
+ * an emoji database only loads the locations of a given size the first
+ * time you request them.
  *
  * Find emojis by category and terms with findEmojis().
  *
  * Add a recent emoji to the "Recent" category with addRecentEmoji().
  * Get all the recent emojis with recentEmojis(). Get the "Recent"
  * category with recentEmojisCat().
+ *
+ * An emoji database also keeps the decayed use count of each accepted
+ * emoji (see `UsageStore`): findEmojis() ranks the most used emoji first
+ * amongst results having the same score, and the "Recent" category is
+ * ordered by use count instead of recency if so configured.
+ *
+ * Likewise, it keeps the decayed pick counts of the emojis accepted
+ * after typing find terms (see `PickAffinity`): findEmojis() pins the
+ * emojis which you often pick for the same find terms first.
+ *
+ * Copy the recent emojis, the use counts, and the pick counts of another
+ * emoji database, for example a previous version of the same one, with
+ * copyRecentEmojis().
+ *
+ * The user emoji keyword file (see userEmojisJsonPath()) may replace or
+ * extend the keywords of some emojis. An emoji database keeps those
+ * user-defined keywords as an overlay (see `UserKeywords`) which
+ * findEmojis() only consults for the emojis it contains: replace it
+ * with userKeywords() and a new overlay from loadUserKeywords(). Get
+ * the effective keywords of an emoji with keywords().
+ *
+ * The "Recent" category, the use counts, the pick counts, and the
+ * user-defined keywords are the only mutable part of an emoji database.
+ * You may call findEmojis() from any thread while the GUI thread
+ * modifies them with recentEmojis(), addRecentEmoji(), or
+ * userKeywords(): a read-write lock protects the first ones and the
+ * database replaces the user-defined keywords atomically. All the other
+ * methods are meant to be called from the GUI thread.
  */
 class EmojiDb final
 {
@@ -298,17 +340,51 @@ public:
         Size48 = 48,
     };
 
+    /*
+     * User-defined keywords: effective keywords of the emojis which the
+     * user emoji keyword file mentions.
+     */
+    using UserKeywords = std::unordered_map<const Emoji *, std::unordered_set<QString>>;
+
 public:
     /*
-     * Builds an emoji database using the data (asset) directory `dir`
-     * and the emoji image size `emojiSize`.
+     * Builds an emoji database using the data (asset) directory `dir`.
      *
-     * At most `maxRecentEmojis` are retrieved from settings if
-     * `noRecentCat` is false.
+     * The "Recent" category, if `noRecentCat` is false, contains at
+     * most `maxRecentEmojis` emojis, ordered by decreasing use count if
+     * `orderRecentByUsage` is true, or by recency otherwise.
+     *
+     * The database loads its user-defined keywords with
+     * loadUserKeywords(strictUserEmojis).
+     */
+    explicit EmojiDb(const QString& dir, unsigned int maxRecentEmojis, bool noRecentCat,
+                     bool incRecentInFindResults, bool orderRecentByUsage,
+                     bool strictUserEmojis = false);
+
+    /*
+     * Path of the user emoji keyword file.
+     */
+    static QString userEmojisJsonPath();
+
+    /*
+     * Paths of the files of the data (asset) directory `dir` from which
+     * an emoji database builds its emojis and categories.
+     */
+    static QStringList dataFilePaths(const QString& dir);
+
+    /*
+     * Returns the emoji image size having the integral size `sizeInt`,
+     * or `std::nullopt` if not supported.
+     */
+    static std::optional<EmojiSize> emojiSizeFromInt(unsigned int sizeInt) noexcept;
+
+    /*
+     * Integral emoji image size of `emojiSize`.
      */
-    explicit EmojiDb(const QString& dir, EmojiSize emojiSize,
-                     unsigned int maxRecentEmojis, bool noRecentCat,
-                     bool incRecentInFindResults);
+    static unsigned int emojiSizeInt(const EmojiSize emojiSize) noexcept
+    {
+        return static_cast<unsigned int>(emojiSize);
+    }
 
     /*
      * Appends the emojis found with the partial category name `cat` and
@@ -318,43 +394,80 @@ public:
                     std::vector<const Emoji *>& results) const;
 
     /*
-     * All the recent emojis.
+     * Like findEmojis() above, but with the find query `query` which
+     * is either `TERMS` or `CAT/TERMS`.
      */
-    void recentEmojis(std::vector<const Emoji *>&& emojis);
+    void findEmojis(const QString& query, std::vector<const Emoji *>& results) const;
+
+    /*
+     * Returns the normalized terms (lowercase, single spaces, trimmed)
+     * of the find query `query` which is either `TERMS` or `CAT/TERMS`.
+     */
+    static QString findTerms(const QString& query);
+
+    /*
+     * Sets all the recent emojis to `emojis` (the most recent first),
+     * the use counts to `usage`, and the pick counts to `affinity`,
+     * returning true if the "Recent" category changed.
+     */
+    bool recentEmojis(std::vector<const Emoji *>&& emojis, UsageStore<const Emoji *>&& usage,
+                      PickAffinity<const Emoji *>&& affinity);
 
     /*
      * Adds the emoji `emoji` as the most recent emoji of the
-     * "Recent" category.
+     * "Recent" category, and adds one use of it as well as one pick of
+     * it for each prefix of the normalized find terms `findTerms`
+     * (see findTerms()).
      *
      * This method only affects the database itself: it doesn't
      * update settings.
      */
-    void addRecentEmoji(const Emoji& emoji);
+    void addRecentEmoji(const Emoji& emoji, const QString& findTerms = {});
 
     /*
-     * Configured emoji image size.
+     * Sets the recent emojis, the use counts, and the pick counts of
+     * this database to the ones of `otherDb`, matching emojis by
+     * string and ignoring the ones which this database doesn't have.
+     *
+     * Returns true if the "Recent" category changed.
      */
-    EmojiSize emojiSize() const
-    {
-        return _emojiSize;
-    }
+    bool copyRecentEmojis(const EmojiDb& otherDb);
+
+    /*
+     * Loads the user emoji keyword file (see userEmojisJsonPath()) and
+     * returns the user-defined keywords of the emojis of this database
+     * which it mentions, or `nullptr` if none.
+     *
+     * If the user emoji keyword file is invalid, then this method warns
+     * and returns `nullptr`, or throws `std::runtime_error` if `strict`
+     * is true.
+     *
+     * This method only reads the immutable part of this database: you
+     * may call it from any thread.
+     */
+    std::shared_ptr<const UserKeywords> loadUserKeywords(bool strict = false) const;
 
     /*
-     * Integral configured emoji image size.
+     * Sets the user-defined keywords to `userKeywords`, as returned by
+     * loadUserKeywords() for this database, or removes them
+     * if `nullptr`.
      */
-    unsigned int emojiSizeInt() const
-    {
-        return static_cast<unsigned int>(_emojiSize);
-    }
+    void userKeywords(std::shared_ptr<const UserKeywords> userKeywords);
+
+    /*
+     * Effective keywords of `emoji`: its user-defined keywords, if any,
+     * or its built-in keywords otherwise.
+     *
+     * The returned reference remains valid until the next call
+     * to userKeywords().
+     */
+    const std::unordered_set<QString>& keywords(const Emoji& emoji) const;
 
     /*
      * Path to the PNG image containing all the emojis of
-     * size emojiSize().
+     * size `emojiSize`.
      */
-    const QString& emojisPngPath() const noexcept
-    {
-        return _emojisPngPath;
-    }
+    QString emojisPngPath(EmojiSize emojiSize) const;
 
     /*
      * All the categories.
@@ -404,25 +517,29 @@ public:
 
     /*
      * Map of emojis to corresponding PNG locations within the
-     * file emojisPngPath().
+     * file emojisPngPath(emojiSize).
      *
      * The locations locate the top-left pixel of the emoji and its
-     * width and height within the whole image is emojiSizeInt().
+     * width and height within the whole image is
+     * emojiSizeInt(emojiSize).
      */
-    const std::unordered_map<const Emoji *, EmojisPngLocation>& emojiPngLocations() const noexcept
-    {
-        return _emojiPngLocations;
-    }
+    const EmojisPngLocations& emojiPngLocations(EmojiSize emojiSize) const;
 
 private:
     /*
-     * Temporary find results.
+     * Find result.
      */
     struct _FindResult final
     {
+        // pick score of the emoji for the find terms (see `PickAffinity`)
+        double pickScore;
+
         // score of the result
         unsigned int score;
 
+        // use score of the emoji (see `UsageStore::score()`)
+        double usage;
+
         // original (global), unique position of the emoji
         unsigned int pos;
 
@@ -431,12 +548,22 @@ private:
 
         bool operator<(const _FindResult& other) const noexcept
         {
-            if (score == other.score) {
-                // same score: fall back to global position
-                return pos < other.pos;
+            if (pickScore != other.pickScore) {
+                // learned picks first
+                return pickScore < other.pickScore;
+            }
+
+            if (score != other.score) {
+                return score < other.score;
+            }
+
+            if (usage != other.usage) {
+                // same score: the most used one first
+                return usage < other.usage;
             }
 
-            return score < other.score;
+            // same score and usage: fall back to global position
+            return pos < other.pos;
         }
     };
 
@@ -454,21 +581,60 @@ private:
     void _createCats(const QString& dir, bool noRecentCat);
 
     /*
-     * Fills `_emojiPngLocations` from the assets found in `dir`.
+     * Returns the PNG locations of the emoji size `emojiSize` from the
+     * assets found in `_dir`.
+     */
+    EmojisPngLocations _loadEmojiPngLocations(EmojiSize emojiSize) const;
+
+    /*
+     * Returns the emoji of this database having the same string as
+     * `emoji`, or `nullptr` if none.
+     */
+    const Emoji *_sameEmoji(const Emoji& emoji) const;
+
+    /*
+     * Sets the emojis of the "Recent" category from
+     * `_recentEmojisByRecency`, returning true if they changed.
+     */
+    bool _updateRecentEmojisCat();
+
+    /*
+     * Effective keywords of `emoji` considering the user-defined
+     * keywords `userKeywords` (may be `nullptr`).
      */
-    void _createEmojiPngLocations(const QString& dir);
+    static const std::unordered_set<QString>& _keywords(const Emoji& emoji,
+                                                        const UserKeywords *userKeywords);
 
 private:
-    const EmojiSize _emojiSize;
-    const QString _emojisPngPath;
+    // minimum decayed pick count of an emoji for findEmojis() to pin it
+    static constexpr double _minPinnedPickCount = 1.5;
+
+private:
+    const QString _dir;
     std::vector<std::unique_ptr<EmojiCat>> _cats;
     std::unordered_map<QString, std::unique_ptr<const Emoji>> _emojis;
-    std::unordered_map<const Emoji *, EmojisPngLocation> _emojiPngLocations;
-    mutable std::set<_FindResult> _tmpFindResults;
-    mutable std::set<const Emoji *> _tmpFindResultEmojis;
+    mutable std::unordered_map<EmojiSize, EmojisPngLocations> _emojiPngLocations;
     EmojiCat *_recentEmojisCat = nullptr;
+
+    /*
+     * User-defined keywords, if any.
+     *
+     * Replaced with std::atomic_store() and read with
+     * std::atomic_load() as findEmojis() may run on another thread.
+     */
+    std::shared_ptr<const UserKeywords> _userKeywords;
+
+    /*
+     * Protects the emojis of `*_recentEmojisCat`,
+     * `_recentEmojisByRecency`, `_usage`, and `_pickAffinity`.
+     */
+    mutable std::shared_mutex _recentEmojisMutex;
+    std::vector<const Emoji *> _recentEmojisByRecency;
+    UsageStore<const Emoji *> _usage;
+    PickAffinity<const Emoji *> _pickAffinity;
     unsigned int _maxRecentEmojis;
     bool _incRecentInFindResults;
+    bool _orderRecentByUsage;
 };
 
 } // namespace jome
@@ -5,28 +5,133 @@
  * of the MIT license. See the LICENSE file for details.
  */
 
+#include <algorithm>
+#include <numeric>
+#include <QFileInfo>
+
+#include "shared-atlas.hpp"
 #include "emoji-images.hpp"
 
 namespace jome {
+namespace {
+
+/*
+ * Estimated memory usage of the pixmap `pixmap`.
+ */
+std::size_t pixmapSize(const QPixmap& pixmap)
+{
+    return static_cast<std::size_t>(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+}
+
+/*
+ * Memory usage of the image `image`.
+ */
+std::size_t imageSize(const QImage& image)
+{
+    return static_cast<std::size_t>(image.sizeInBytes());
+}
+
+} // namespace
 
-EmojiImages::EmojiImages(const EmojiDb& db)
+EmojiImages::EmojiImages(const EmojiDb& db, const std::size_t maxSize) :
+    _db {&db},
+    _maxSize {maxSize}
 {
-    this->_createPixmaps(db);
 }
 
-void EmojiImages::_createPixmaps(const EmojiDb& db)
+void EmojiImages::emojiDb(const EmojiDb& db)
 {
-    auto emojisPixmap = QPixmap::fromImage(QImage {db.emojisPngPath()});
+    _db = &db;
+
+    for (auto it = _atlases.begin(); it != _atlases.end();) {
+        const QFileInfo info {_db->emojisPngPath(it->emojiSize)};
+
+        if (info.filePath() != it->path || info.lastModified() != it->lastModified) {
+            // different image: load it again on demand
+            it = _atlases.erase(it);
+            continue;
+        }
+
+        // keys are emojis of the previous database
+        it->emojiPixmaps.clear();
+        it->size = imageSize(it->image);
+        ++it;
+    }
+}
 
-    for (auto& emojiPngLocation : db.emojiPngLocations()) {
-        auto& pngLoc = emojiPngLocation.second;
-        const auto emojiSize = db.emojiSizeInt();
+EmojiImages::_Atlas& EmojiImages::_atlas(const EmojiDb::EmojiSize emojiSize) const
+{
+    const auto it = std::find_if(_atlases.begin(), _atlases.end(),
+                                 [emojiSize](const _Atlas& atlas) {
+        return atlas.emojiSize == emojiSize;
+    });
 
-        _emojiPixmaps[emojiPngLocation.first] = std::make_unique<QPixmap>(emojisPixmap.copy(pngLoc.x,
-                                                                                            pngLoc.y,
-                                                                                            emojiSize,
-                                                                                            emojiSize));
+    if (it != _atlases.end()) {
+        // most recently used now
+        _atlases.splice(_atlases.begin(), _atlases, it);
+        return _atlases.front();
     }
+
+    // load
+    _Atlas atlas;
+
+    atlas.emojiSize = emojiSize;
+    atlas.path = _db->emojisPngPath(emojiSize);
+    atlas.lastModified = QFileInfo {atlas.path}.lastModified();
+    atlas.image = loadSharedAtlas(atlas.path);
+    atlas.size = imageSize(atlas.image);
+    _atlases.push_front(std::move(atlas));
+    this->_evict();
+    return _atlases.front();
+}
+
+void EmojiImages::_evict() const
+{
+    auto totalSize = std::accumulate(_atlases.begin(), _atlases.end(), std::size_t {0},
+                                     [](const std::size_t size, const _Atlas& atlas) {
+        return size + atlas.size;
+    });
+
+    while (totalSize > _maxSize && _atlases.size() > 1) {
+        /*
+         * Graphics items have their own (implicitly shared) copy of
+         * the emoji pixmaps: safe to unload.
+         */
+        totalSize -= _atlases.back().size;
+        _atlases.pop_back();
+    }
+}
+
+void EmojiImages::clear()
+{
+    _atlases.clear();
+}
+
+void EmojiImages::preload(const EmojiDb::EmojiSize emojiSize) const
+{
+    this->_atlas(emojiSize);
+    _db->emojiPngLocations(emojiSize);
+}
+
+const QPixmap& EmojiImages::pixmapForEmoji(const Emoji& emoji,
+                                           const EmojiDb::EmojiSize emojiSize) const
+{
+    auto& atlas = this->_atlas(emojiSize);
+    auto& pixmap = atlas.emojiPixmaps[&emoji];
+
+    if (!pixmap) {
+        const auto& pngLoc = _db->emojiPngLocations(emojiSize).at(&emoji);
+        const auto emojiSizeInt = EmojiDb::emojiSizeInt(emojiSize);
+
+        pixmap = std::make_unique<QPixmap>(QPixmap::fromImage(
+            atlas.image.copy(pngLoc.x, pngLoc.y, emojiSizeInt, emojiSizeInt)));
+        atlas.size += pixmapSize(*pixmap);
+
+        // keeps `atlas` (most recently used)
+        this->_evict();
+    }
+
+    return *pixmap;
 }
 
 } // namespace jome
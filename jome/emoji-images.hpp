@@ -9,8 +9,12 @@
 #define _JOME_EMOJI_IMAGES_HPP
 
 #include <memory>
+#include <list>
 #include <unordered_map>
+#include <QDateTime>
+#include <QImage>
 #include <QPixmap>
+#include <QString>
 
 #include "emoji-db.hpp"
 
@@ -19,33 +23,102 @@ namespace jome {
 /*
  * All the emoji images.
  *
- * An `EmojiImages` instance holds a map of emoji to
+ * An `EmojiImages` instance holds, for each loaded emoji size, the
+ * whole emoji image (atlas) of this size and a map of emoji to
  * corresponding `QPixmap`.
+ *
+ * The decoded atlases are shared with the other jome processes (see
+ * loadSharedAtlas()).
+ *
+ * An `EmojiImages` instance only loads the atlas of a given emoji size
+ * the first time you call pixmapForEmoji() with this size, and only
+ * copies the image of a given emoji the first time you call
+ * pixmapForEmoji() for it.
+ *
+ * Loaded atlases form an LRU cache: when the estimated memory usage of
+ * all the loaded atlases and emoji images exceeds the cap, an
+ * `EmojiImages` instance unloads the least recently used atlases
+ * (never the one it just used).
  */
 class EmojiImages final
 {
 public:
     /*
-     * Builds all the emoji images from the database `db`.
+     * Builds an empty emoji image container for the database `db`,
+     * keeping loaded atlases and emoji images until their estimated
+     * memory usage reaches `maxSize` bytes.
+     */
+    explicit EmojiImages(const EmojiDb& db, std::size_t maxSize = 48 * 1024 * 1024);
+
+    /*
+     * Makes this container use the database `db` from now on.
+     *
+     * This drops all the emoji images, as well as the loaded atlases of
+     * which the file changed.
+     */
+    void emojiDb(const EmojiDb& db);
+
+    /*
+     * Returns the image of the emoji `emoji` having the size
+     * `emojiSize`.
+     *
+     * The returned reference remains valid until the next call with
+     * another emoji size.
+     */
+    const QPixmap& pixmapForEmoji(const Emoji& emoji, EmojiDb::EmojiSize emojiSize) const;
+
+    /*
+     * Loads the atlas and the emoji PNG locations of the emoji size
+     * `emojiSize` now instead of on the first call to
+     * pixmapForEmoji().
      */
-    explicit EmojiImages(const EmojiDb& db);
+    void preload(EmojiDb::EmojiSize emojiSize) const;
 
     /*
-     * Returns the image of the emoji `emoji`.
+     * Unloads all the atlases and emoji images.
      */
-    const QPixmap& pixmapForEmoji(const Emoji& emoji) const
+    void clear();
+
+private:
+    /*
+     * Loaded atlas of a given emoji size and corresponding
+     * emoji images.
+     */
+    struct _Atlas final
     {
-        return *_emojiPixmaps.at(&emoji);
-    }
+        EmojiDb::EmojiSize emojiSize;
+        QImage image;
+
+        // file of `image` and its modification time when loaded
+        QString path;
+        QDateTime lastModified;
+
+        std::unordered_map<const Emoji *, std::unique_ptr<QPixmap>> emojiPixmaps;
+
+        // estimated memory usage (bytes)
+        std::size_t size;
+    };
 
 private:
     /*
-     * Fills `_emojiPixmaps` from the database `db`.
+     * Returns the atlas of the emoji size `emojiSize`, loading it
+     * if needed, and marks it as the most recently used one.
      */
-    void _createPixmaps(const EmojiDb& db);
+    _Atlas& _atlas(EmojiDb::EmojiSize emojiSize) const;
+
+    /*
+     * Unloads the least recently used atlases until the total
+     * estimated memory usage is at most `_maxSize`, always keeping the
+     * most recently used one.
+     */
+    void _evict() const;
 
 private:
-    std::unordered_map<const Emoji *, std::unique_ptr<QPixmap>> _emojiPixmaps;
+    const EmojiDb *_db;
+    const std::size_t _maxSize;
+
+    // most recently used first
+    mutable std::list<_Atlas> _atlases;
 };
 
 } // namespace jome
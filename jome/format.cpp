@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2019-2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <functional>
+
+#include "format.hpp"
+#include "utils.hpp"
+
+namespace jome {
+
+std::optional<Format> formatFromName(const QString& name)
+{
+    if (name == "utf-8") {
+        return Format::Utf8;
+    } else if (name == "cp") {
+        return Format::CodepointsHex;
+    }
+
+    return std::nullopt;
+}
+
+QString formatName(const Format fmt)
+{
+    switch (fmt) {
+    case Format::Utf8:
+        return "utf-8";
+
+    case Format::CodepointsHex:
+        return "cp";
+    }
+
+    return {};
+}
+
+std::optional<Emoji::SkinTone> skinToneFromName(const QString& name)
+{
+    if (const auto uName = name.toUpper(); uName == "L") {
+        return Emoji::SkinTone::Light;
+    } else if (uName == "ML") {
+        return Emoji::SkinTone::MediumLight;
+    } else if (uName == "M") {
+        return Emoji::SkinTone::Medium;
+    } else if (uName == "MD") {
+        return Emoji::SkinTone::MediumDark;
+    } else if (uName == "D") {
+        return Emoji::SkinTone::Dark;
+    }
+
+    return std::nullopt;
+}
+
+QString skinToneName(const Emoji::SkinTone skinTone)
+{
+    switch (skinTone) {
+    case Emoji::SkinTone::Light:
+        return "L";
+
+    case Emoji::SkinTone::MediumLight:
+        return "ML";
+
+    case Emoji::SkinTone::Medium:
+        return "M";
+
+    case Emoji::SkinTone::MediumDark:
+        return "MD";
+
+    case Emoji::SkinTone::Dark:
+        return "D";
+    }
+
+    return {};
+}
+
+QString formatEmoji(const Emoji& emoji, const std::optional<Emoji::SkinTone> skinTone,
+                    const std::optional<Emoji::SkinTone> defSkinTone, const Format fmt,
+                    const QString& cpPrefix, const bool noNl, const bool removeVs16)
+{
+    QString output;
+    const auto realSkinTone = skinTone ? skinTone : defSkinTone;
+
+    switch (fmt) {
+    case Format::Utf8:
+    {
+        if (realSkinTone && emoji.hasSkinToneSupport()) {
+            output = emoji.str(*realSkinTone, !removeVs16);
+        } else {
+            output = emoji.str(std::nullopt, !removeVs16);
+        }
+
+        break;
+    }
+
+    case Format::CodepointsHex:
+    {
+        const auto codepoints = std::invoke([realSkinTone, &emoji, &removeVs16] {
+            if (realSkinTone && emoji.hasSkinToneSupport()) {
+                return emoji.codepoints(*realSkinTone, !removeVs16);
+            } else {
+                return emoji.codepoints(std::nullopt, !removeVs16);
+            }
+        });
+
+        for (const auto codepoint : codepoints) {
+            output += qFmtFormat("{}{:x} ", cpPrefix.toStdString(), codepoint);
+        }
+
+        // remove trailing space
+        output.resize(output.size() - 1);
+        break;
+    }
+    }
+
+    if (!noNl) {
+        output += '\n';
+    }
+
+    return output;
+}
+
+} // namespace jome
@@ -0,0 +1,69 @@
+/*
+ * Copyright (C) 2019-2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_FORMAT_HPP
+#define _JOME_FORMAT_HPP
+
+#include <QString>
+#include <optional>
+
+#include "emoji-db.hpp"
+
+namespace jome {
+
+/*
+ * Output format.
+ */
+enum class Format
+{
+    Utf8,
+    CodepointsHex,
+};
+
+/*
+ * Returns the output format named `name` (`utf-8` or `cp`), or
+ * `std::nullopt` if unknown.
+ */
+std::optional<Format> formatFromName(const QString& name);
+
+/*
+ * Returns the name of the output format `fmt`.
+ */
+QString formatName(Format fmt);
+
+/*
+ * Returns the skin tone named `name` (`L`, `ML`, `M`, `MD`, or `D`,
+ * case-insensitive), or `std::nullopt` if unknown.
+ */
+std::optional<Emoji::SkinTone> skinToneFromName(const QString& name);
+
+/*
+ * Returns the name of the skin tone `skinTone` (`L`, `ML`, `M`, `MD`,
+ * or `D`).
+ */
+QString skinToneName(Emoji::SkinTone skinTone);
+
+/*
+ * Formats the emoji `emoji` with the format `fmt` and returns
+ * the string.
+ *
+ * Adds a skin tone modifier depending on `skinTone` and `defSkinTone`.
+ *
+ * If `fmt` is `Format::CodepointsHex`, prepends `cpPrefix` to each
+ * hexadecimal codepoint.
+ *
+ * Removes VS-16 codepoints if `removeVs16` is true.
+ *
+ * Adds a newline if `noNl` is false.
+ */
+QString formatEmoji(const Emoji& emoji, std::optional<Emoji::SkinTone> skinTone,
+                    std::optional<Emoji::SkinTone> defSkinTone, Format fmt,
+                    const QString& cpPrefix, bool noNl, bool removeVs16);
+
+} // namespace jome
+
+#endif // _JOME_FORMAT_HPP
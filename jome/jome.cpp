@@ -11,51 +11,69 @@
 #include <QString>
 #include <QProcess>
 #include <QTimer>
+#include <QThread>
+#include <QFile>
+#include <QFileSystemWatcher>
+#include <QPixmapCache>
 #include <iostream>
+#include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <fstream>
+#include <memory>
 #include <optional>
-#include <functional>
+#include <unistd.h>
 #include <fmt/format.h>
 
+#ifdef __GLIBC__
+# include <malloc.h>
+#endif
+
 #include "emoji-db.hpp"
+#include "format.hpp"
+#include "delegate.hpp"
+#include "proto.hpp"
+#include "q-cmd-runner.hpp"
+#include "q-file-reloader.hpp"
 #include "q-jome-window.hpp"
 #include "q-jome-server.hpp"
+#include "recent-emojis-log.hpp"
 #include "settings.hpp"
-#include "utils.hpp"
-
-/*
- * Output format.
- */
-enum class Format
-{
-    Utf8,
-    CodepointsHex,
-};
+#include "stats.hpp"
 
 /*
  * Command-line parameters in no particular order.
  */
 struct Params final
 {
-    Format fmt;
+    jome::Format fmt;
     bool noNewline;
     bool noHide;
     bool darkBg;
     bool copyToClipboard;
     std::optional<QString> serverName;
+    std::optional<int> readyFd;
+    std::optional<QString> readyFilePath;
+    std::optional<unsigned int> releaseDelay;
+    bool noDelegate;
+    bool hasWindowOpts;
     std::optional<QString> cmd;
     QString cpPrefix;
     jome::EmojiDb::EmojiSize emojiSize;
+    bool emojiSizeIsSet;
     std::optional<unsigned int> selectedEmojiFlashPeriod;
+    unsigned int cmdDelay;
     unsigned int maxRecentEmojis;
     bool removeVs16;
     bool noCatList;
     bool noCatLabels;
     bool noRecentCat;
     bool noKwList;
+    bool tileCache;
+    bool progressiveBuild;
     std::optional<jome::Emoji::SkinTone> defSkinTone;
     bool incRecentInFindResults;
+    bool orderRecentByUsage;
 };
 
 namespace {
@@ -75,17 +93,26 @@ Params parseArgs(QApplication& app)
     const QCommandLineOption defSkinToneOpt {"t", "Set default skin tone to <TONE> (`L`, `ML`, `M`, `MD`, or `D`).", "TONE"};
     const QCommandLineOption incRecentInFindResultsOpt {"r", "Include recently accepted emojis in find results."};
     const QCommandLineOption cmdOpt {"c", "Execute external command <CMD> with accepted emoji.", "CMD"};
+    const QCommandLineOption cmdDelayOpt {"W", "Execute external command <DELAY> ms after hiding the window.", "DELAY"};
     const QCommandLineOption copyToClipboardOpt {"b", "Copy the accepted emoji to the clipboard."};
     const QCommandLineOption noHideOpt {"q", "Do not quit when accepting."};
     const QCommandLineOption serverNameOpt {"s", "Set server name to <NAME>.", "NAME"};
+    const QCommandLineOption defServerOpt {"D", "Start the default server."};
+    const QCommandLineOption noDelegateOpt {"no-delegate", "Do not delegate to the default server."};
+    const QCommandLineOption readyFdOpt {"ready-fd", "Write `READY` to file descriptor <FD> once the server is ready.", "FD"};
+    const QCommandLineOption readyFileOpt {"ready-file", "Create file <PATH> once the server is ready.", "PATH"};
+    const QCommandLineOption releaseDelayOpt {"I", "Release memory once the window is hidden for <DELAY> s (server mode).", "DELAY"};
     const QCommandLineOption darkBgOpt {"d", "Use dark emoji background."};
     const QCommandLineOption noCatListOpt {"C", "Hide category list."};
     const QCommandLineOption noCatLabelsOpt {"L", "Hide category labels."};
     const QCommandLineOption noRecentCatOpt {"R", "Hide \"Recent\" category."};
     const QCommandLineOption noKwListOpt {"k", "Hide keyword list."};
+    const QCommandLineOption tileCacheOpt {"T", "Render category panels as cached tiles."};
+    const QCommandLineOption progressiveBuildOpt {"g", "Build the emoji grid progressively."};
     const QCommandLineOption emojiWidthOpt {"w", "Set emoji width to <WIDTH> px (16, 24, 32, 40, or 48).", "WIDTH"};
     const QCommandLineOption selectedEmojiFlashPeriodOpt {"P", "Set selected emoji flashing period to <PERIOD> ms.", "PERIOD"};
     const QCommandLineOption maxRecentEmojisOpt {"H", "Set maximum number of recently accepted emojis to <COUNT>.", "COUNT"};
+    const QCommandLineOption orderRecentByUsageOpt {"U", "Order \"Recent\" category by usage frequency."};
 
     parser.addOption(formatOpt);
     parser.addOption(cpPrefixOpt);
@@ -94,17 +121,26 @@ Params parseArgs(QApplication& app)
     parser.addOption(defSkinToneOpt);
     parser.addOption(incRecentInFindResultsOpt);
     parser.addOption(cmdOpt);
+    parser.addOption(cmdDelayOpt);
     parser.addOption(copyToClipboardOpt);
     parser.addOption(noHideOpt);
     parser.addOption(serverNameOpt);
+    parser.addOption(defServerOpt);
+    parser.addOption(noDelegateOpt);
+    parser.addOption(readyFdOpt);
+    parser.addOption(readyFileOpt);
+    parser.addOption(releaseDelayOpt);
     parser.addOption(darkBgOpt);
     parser.addOption(noCatListOpt);
     parser.addOption(noCatLabelsOpt);
     parser.addOption(noRecentCatOpt);
     parser.addOption(noKwListOpt);
+    parser.addOption(tileCacheOpt);
+    parser.addOption(progressiveBuildOpt);
     parser.addOption(emojiWidthOpt);
     parser.addOption(selectedEmojiFlashPeriodOpt);
     parser.addOption(maxRecentEmojisOpt);
+    parser.addOption(orderRecentByUsageOpt);
     parser.process(app);
 
     Params params;
@@ -118,28 +154,115 @@ Params parseArgs(QApplication& app)
     params.noCatLabels = parser.isSet(noCatLabelsOpt);
     params.noRecentCat = parser.isSet(noRecentCatOpt);
     params.noKwList = parser.isSet(noKwListOpt);
+    params.tileCache = parser.isSet(tileCacheOpt);
+    params.progressiveBuild = parser.isSet(progressiveBuildOpt);
     params.incRecentInFindResults = parser.isSet(incRecentInFindResultsOpt);
-
-    if (const auto fmt = parser.value(formatOpt); fmt == "utf-8") {
-        params.fmt = Format::Utf8;
-    } else if (fmt == "cp") {
-        params.fmt = Format::CodepointsHex;
+    params.orderRecentByUsage = parser.isSet(orderRecentByUsageOpt);
+    params.noDelegate = parser.isSet(noDelegateOpt);
+    params.emojiSizeIsSet = parser.isSet(emojiWidthOpt);
+
+    // options which a running server wouldn't honour
+    params.hasWindowOpts = params.noHide || params.darkBg || params.noCatList ||
+                           params.noCatLabels || params.noRecentCat || params.noKwList ||
+                           params.tileCache || params.progressiveBuild ||
+                           params.incRecentInFindResults || params.orderRecentByUsage ||
+                           parser.isSet(selectedEmojiFlashPeriodOpt) ||
+                           parser.isSet(maxRecentEmojisOpt);
+
+    if (const auto fmt = parser.value(formatOpt); const auto fmtVal = jome::formatFromName(fmt)) {
+        params.fmt = *fmtVal;
     } else {
         std::cerr << "Command-line error: unknown format `" << fmt.toUtf8().constData() << "`.\n";
         std::exit(1);
     }
 
-    if (parser.isSet(serverNameOpt)) {
+    if (parser.isSet(serverNameOpt) || parser.isSet(defServerOpt)) {
+        const auto opt = parser.isSet(serverNameOpt) ? "-s" : "-D";
+
         if (params.noHide) {
-            std::cerr << "Command-line error: cannot specify `-s` and `-q` options together.\n";
+            std::cerr << "Command-line error: cannot specify `" << opt <<
+                         "` and `-q` options together.\n";
+            std::exit(1);
+        }
+
+        if (parser.isSet(serverNameOpt) && parser.isSet(defServerOpt)) {
+            std::cerr << "Command-line error: cannot specify `-s` and `-D` options together.\n";
+            std::exit(1);
+        }
+
+        if (parser.isSet(serverNameOpt)) {
+            params.serverName = parser.value(serverNameOpt).toUtf8().constData();
+        } else {
+            params.serverName = QString::fromStdString(jome::proto::defaultServerName());
+        }
+    }
+
+    if (parser.isSet(readyFdOpt)) {
+        bool ok;
+        const auto strVal = parser.value(readyFdOpt);
+        const auto val = strVal.toInt(&ok);
+
+        if (!ok || val < 0) {
+            std::cerr << "Command-line error: unexpected value for `--ready-fd`: `" <<
+                         strVal.toUtf8().constData() << "`.\n";
+            std::exit(1);
+        }
+
+        params.readyFd = val;
+    }
+
+    if (parser.isSet(readyFileOpt)) {
+        params.readyFilePath = parser.value(readyFileOpt);
+    }
+
+    if ((params.readyFd || params.readyFilePath) && !params.serverName) {
+        std::cerr << "Command-line error: `--ready-fd` and `--ready-file` options " <<
+                     "require the `-s` or `-D` option.\n";
+        std::exit(1);
+    }
+
+    if (parser.isSet(releaseDelayOpt)) {
+        bool ok;
+        const auto strVal = parser.value(releaseDelayOpt);
+        const auto val = strVal.toUInt(&ok);
+
+        if (!ok) {
+            std::cerr << "Command-line error: unexpected value for `-I`: `" <<
+                         strVal.toUtf8().constData() << "`.\n";
+            std::exit(1);
+        }
+
+        if (!params.serverName) {
+            std::cerr << "Command-line error: `-I` option requires the `-s` or `-D` option.\n";
             std::exit(1);
         }
 
-        params.serverName = parser.value(serverNameOpt).toUtf8().constData();
+        params.releaseDelay = val;
     }
 
     if (parser.isSet(cmdOpt)) {
         params.cmd = parser.value(cmdOpt).toUtf8().constData();
+
+        if (QProcess::splitCommand(*params.cmd).isEmpty()) {
+            std::cerr << "Command-line error: empty command for `-c`.\n";
+            std::exit(1);
+        }
+    }
+
+    params.cmdDelay = 20;
+
+    if (parser.isSet(cmdDelayOpt)) {
+        bool ok;
+        const auto strVal = parser.value(cmdDelayOpt);
+        const auto val = strVal.toUInt(&ok);
+
+        if (!ok) {
+            std::cerr << "Command-line error: unexpected value for `-W`: `" <<
+                         strVal.toUtf8().constData() << "`.\n";
+            std::exit(1);
+        }
+
+        params.cmdDelay = val;
     }
 
     if (parser.isSet(cpPrefixOpt)) {
@@ -197,17 +320,9 @@ Params parseArgs(QApplication& app)
     }
 
     if (parser.isSet(defSkinToneOpt)) {
-        if (const auto val = parser.value(defSkinToneOpt).toUpper(); val == "L") {
-            params.defSkinTone = jome::Emoji::SkinTone::Light;
-        } else if (val == "ML") {
-            params.defSkinTone = jome::Emoji::SkinTone::MediumLight;
-        } else if (val == "M") {
-            params.defSkinTone = jome::Emoji::SkinTone::Medium;
-        } else if (val == "MD") {
-            params.defSkinTone = jome::Emoji::SkinTone::MediumDark;
-        } else if (val == "D") {
-            params.defSkinTone = jome::Emoji::SkinTone::Dark;
-        } else {
+        params.defSkinTone = jome::skinToneFromName(parser.value(defSkinToneOpt));
+
+        if (!params.defSkinTone) {
             std::cerr << "Command-line error: unexpected value for `-t`: `" <<
                          parser.value(defSkinToneOpt).toUtf8().constData() << "`.\n";
             std::exit(1);
@@ -218,83 +333,175 @@ Params parseArgs(QApplication& app)
 }
 
 /*
- * Executes the command `cmd` with the arguments `arg` (shell context).
+ * Returns the command arguments for the formatted emoji `emojiStr`:
+ * one argument per codepoint with the `cp` format.
  */
-void execCommand(const QString& cmd, const QString& arg)
+QStringList cmdArgs(const QString& emojiStr)
 {
-    static_cast<void>(QProcess::execute(cmd + ' ' + arg));
+    return emojiStr.split(' ', Qt::SkipEmptyParts);
 }
 
 /*
- * Formats the emoji `emoji` with the format `fmt` and returns
- * the string.
- *
- * Adds a skin tone modifier depending on `skinTone` and `defSkinTone`.
+ * Formats the emoji `emoji` like formatEmoji() for the server request
+ * `req`, using the output options of `params` which `req` doesn't
+ * override.
  *
- * If `fmt` is `Format::CodepointsHex`, prepends `cpPrefix` to each
- * hexadecimal codepoint.
- *
- * Removes VS-16 codepoints if `removeVs16` is true.
+ * Doesn't add a newline if `noNl` is true, whatever `req`.
+ */
+QString formatEmojiForReq(const jome::Emoji& emoji,
+                          const std::optional<jome::Emoji::SkinTone> skinTone,
+                          const bool noNl, const bool removeVs16, const Params& params,
+                          const jome::QJomeServer::Request& req)
+{
+    return jome::formatEmoji(emoji, skinTone, req.skinTone ? req.skinTone : params.defSkinTone,
+                             req.fmt.value_or(params.fmt), req.cpPrefix.value_or(params.cpPrefix),
+                             noNl || req.noNewline.value_or(params.noNewline ||
+                                                            params.cmd.has_value()),
+                             removeVs16 || req.removeVs16.value_or(params.removeVs16));
+}
+
+/*
+ * Returns the `pick` request fields to delegate picking an emoji
+ * according to `params` to a jome server.
+ */
+jome::proto::Fields delegatedPickFields(const Params& params)
+{
+    jome::proto::Fields fields;
+
+    fields["fmt"] = jome::formatName(params.fmt).toStdString();
+    fields["cp-prefix"] = params.cpPrefix.toStdString();
+    fields["no-vs16"] = static_cast<std::uint64_t>(params.removeVs16);
+    fields["no-newline"] = static_cast<std::uint64_t>(params.noNewline || params.cmd);
+
+    if (params.defSkinTone) {
+        fields["skin-tone"] = jome::skinToneName(*params.defSkinTone).toStdString();
+    }
+
+    if (params.emojiSizeIsSet) {
+        fields["width"] = static_cast<std::uint64_t>(jome::EmojiDb::emojiSizeInt(params.emojiSize));
+    }
+
+    return fields;
+}
+
+/*
+ * Tries to pick an emoji with the default jome server, if any,
+ * according to `params`.
  *
- * Adds a newline if `noNl` is false.
+ * Returns the exit code, or `std::nullopt` if there's no usable
+ * default server.
  */
-QString formatEmoji(const jome::Emoji& emoji,
-                    std::optional<jome::Emoji::SkinTone> skinTone,
-                    std::optional<jome::Emoji::SkinTone> defSkinTone,
-                    const Format fmt,
-                    const QString& cpPrefix, const bool noNl, const bool removeVs16)
+std::optional<int> delegatePick(const Params& params)
 {
-    QString output;
-    const auto realSkinTone = skinTone ? skinTone : defSkinTone;
-
-    switch (fmt) {
-    case Format::Utf8:
-    {
-        if (realSkinTone && emoji.hasSkinToneSupport()) {
-            output = emoji.str(*realSkinTone, !removeVs16);
-        } else {
-            output = emoji.str(std::nullopt, !removeVs16);
-        }
+    const auto reply = jome::delegatePick(QString::fromStdString(jome::proto::defaultServerName()),
+                                          delegatedPickFields(params));
 
-        break;
+    if (!reply) {
+        return std::nullopt;
     }
 
-    case Format::CodepointsHex:
-    {
-        const auto codepoints = std::invoke([realSkinTone, &emoji, &removeVs16] {
-            if (realSkinTone && emoji.hasSkinToneSupport()) {
-                return emoji.codepoints(*realSkinTone, !removeVs16);
-            } else {
-                return emoji.codepoints(std::nullopt, !removeVs16);
-            }
-        });
+    if (reply->error) {
+        // the server may already have shown its window: don't show another one
+        std::cerr << "Error: default server: " << reply->error->toUtf8().constData() << ".\n";
+        return 1;
+    }
+
+    if (reply->cancelled) {
+        return 1;
+    }
+
+    // like when accepting an emoji in direct mode
+    std::cout << reply->output.toStdString();
+    std::cout.flush();
+
+    if (params.copyToClipboard) {
+        QGuiApplication::clipboard()->setText(reply->output);
+    }
 
-        for (const auto codepoint : codepoints) {
-            output += jome::qFmtFormat("{}{:x} ", cpPrefix.toStdString(), codepoint);
+    if (params.cmd) {
+        // the server hides its window as it replies; nothing else to do meanwhile
+        QThread::msleep(params.cmdDelay);
+        jome::QCmdRunner::runSync(*params.cmd, cmdArgs(reply->output));
+    }
+
+    return 0;
+}
+
+/*
+ * Notifies whoever is waiting for the server to be ready according
+ * to `params`.
+ */
+void notifyServerReady(const Params& params)
+{
+    if (params.readyFd) {
+        static constexpr char msg[] = "READY\n";
+
+        if (write(*params.readyFd, msg, sizeof msg - 1) < 0) {
+            std::cerr << "Warning: cannot write to file descriptor " << *params.readyFd << ".\n";
         }
 
-        // remove trailing space
-        output.resize(output.size() - 1);
-        break;
+        close(*params.readyFd);
     }
+
+    if (params.readyFilePath) {
+        QFile file {*params.readyFilePath};
+
+        if (file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            // process ID as content
+            file.write(QByteArray::number(QCoreApplication::applicationPid()) + '\n');
+        } else {
+            std::cerr << "Warning: cannot create ready file `" <<
+                         params.readyFilePath->toUtf8().constData() << "`.\n";
+        }
     }
+}
+
+/*
+ * Returns the resident set size of this process, in MiB, or
+ * `std::nullopt` if unknown.
+ */
+std::optional<double> residentSetSizeMib()
+{
+    std::ifstream statm {"/proc/self/statm"};
+    unsigned long long size, resident;
 
-    if (!noNl) {
-        output += '\n';
+    if (!(statm >> size >> resident)) {
+        return std::nullopt;
     }
 
-    return output;
+    return static_cast<double>(resident) * sysconf(_SC_PAGESIZE) / (1024. * 1024.);
+}
+
+/*
+ * Reports, to the standard error, the memory transition `what` of
+ * this process, the resident set size going from `rssBefore`
+ * to `rssAfter`.
+ */
+void reportMemTransition(const char * const what, const std::optional<double> rssBefore,
+                         const std::optional<double> rssAfter)
+{
+    if (!rssBefore || !rssAfter) {
+        std::cerr << "Info: " << what << ".\n";
+        return;
+    }
+
+    std::cerr << "Info: " << what << " (RSS: " <<
+                 fmt::format("{:.1f} MiB -> {:.1f} MiB", *rssBefore, *rssAfter) << ").\n";
 }
 
 /*
  * Shows the jome window working with the database `db`.
  *
- * Also updates the "Recent" category, if any, from the settings.
+ * Also updates the "Recent" category, if any, from the recent emoji
+ * log `recentLog` if another process changed it (in case the watcher
+ * didn't report it yet).
  */
-void showWindow(jome::QJomeWindow& win, jome::EmojiDb& db)
+void showWindow(jome::QJomeWindow& win, jome::EmojiDb& db, jome::RecentEmojisLog& recentLog)
 {
-    jome::updateRecentEmojisFromSettings(db);
-    QTimer::singleShot(0, &win, &jome::QJomeWindow::emojiDbChanged);
+    if (jome::updateRecentEmojisFromLog(db, recentLog)) {
+        win.recentEmojisChanged();
+    }
+
     win.show();
 }
 
@@ -313,30 +520,150 @@ int main(int argc, char ** const argv)
     // parse command-line parameters
     const auto params = parseArgs(app);
 
-    // create emoji database
-    jome::EmojiDb db {
-        JOME_DATA_DIR, params.emojiSize, params.maxRecentEmojis, params.noRecentCat,
-        params.incRecentInFindResults
+    if (!params.serverName && !params.noDelegate && !params.hasWindowOpts) {
+        // let the default server pick an emoji, if it's running
+        if (const auto exitCode = delegatePick(params)) {
+            return *exitCode;
+        }
+    }
+
+    // creates an emoji database
+    const auto createDb = [&params](const bool strictUserEmojis) {
+        return std::make_shared<jome::EmojiDb>(JOME_DATA_DIR, params.maxRecentEmojis,
+                                               params.noRecentCat,
+                                               params.incRecentInFindResults,
+                                               params.orderRecentByUsage, strictUserEmojis);
     };
 
+    /*
+     * Current emoji database.
+     *
+     * Only the GUI thread replaces it (see `QFileReloader`), with
+     * std::atomic_store(): the server thread gets it with
+     * std::atomic_load() to find emojis.
+     */
+    auto db = createDb(false);
+
+    /*
+     * Recent emoji log, shared with the other jome processes: its
+     * destructor waits for the pending writes.
+     */
+    jome::RecentEmojisLog recentLog {jome::recentEmojisLogPath()};
+
+    // runtime statistics
+    jome::Stats stats;
+
     // create window (not visible yet)
-    jome::QJomeWindow win {db, params.darkBg, params.noCatList, params.noCatLabels,
-                           params.noKwList, params.selectedEmojiFlashPeriod};
+    jome::QJomeWindow win {*db, stats, params.emojiSize, params.darkBg, params.noCatList,
+                           params.noCatLabels, params.noKwList, params.tileCache,
+                           params.progressiveBuild, params.selectedEmojiFlashPeriod};
 
-    // possible server
+    // possible server and its thread
+    QThread serverThread;
     std::unique_ptr<jome::QJomeServer> server;
 
+    // current server `pick` request
+    jome::QJomeServer::Request curPickReq;
+
+    // reception time of the `pick` request waiting for the window to show
+    std::optional<std::chrono::steady_clock::time_point> pickRecvTime;
+
+    // `QJomeWindow::shown` signal
+    QObject::connect(&win, &jome::QJomeWindow::shown, [&stats, &pickRecvTime]() {
+        if (pickRecvTime) {
+            stats.record(jome::Stats::Latency::PickToVisible,
+                         std::chrono::steady_clock::now() - *pickRecvTime);
+            pickRecvTime = std::nullopt;
+        }
+    });
+
+    // external command (`-c` option) runner
+    jome::QCmdRunner cmdRunner {nullptr, stats};
+
+    // arguments of the command to run once the window is hidden
+    std::optional<QStringList> pendingCmdArgs;
+
+    // runs the command with the arguments `args` in `params.cmdDelay` ms
+    const auto runCmd = [&params, &cmdRunner](const QStringList& args) {
+        QTimer::singleShot(params.cmdDelay, &cmdRunner, [&params, &cmdRunner, args]() {
+            cmdRunner.run(*params.cmd, args);
+        });
+    };
+
+    // `QCmdRunner::idle` signal
+    QObject::connect(&cmdRunner, &jome::QCmdRunner::idle, [&params, &server, &app]() {
+        if (!server && !params.noHide) {
+            // no server: quit after executing the command
+            QTimer::singleShot(0, &app, &QApplication::quit);
+        }
+    });
+
+    // `QJomeWindow::hidden` signal
+    QObject::connect(&win, &jome::QJomeWindow::hidden, [&pendingCmdArgs, &runCmd]() {
+        if (pendingCmdArgs) {
+            runCmd(*pendingCmdArgs);
+            pendingCmdArgs = std::nullopt;
+        }
+    });
+
+    /*
+     * Release memory once the window stays hidden for
+     * `*params.releaseDelay` s (`-I` option): showing it again rebuilds
+     * the emoji grid and loads the emoji images on demand.
+     */
+    QTimer releaseTimer;
+    bool released = false;
+    std::optional<double> releasedRss;
+
+    releaseTimer.setSingleShot(true);
+
+    if (params.releaseDelay) {
+        releaseTimer.setInterval(std::chrono::seconds {*params.releaseDelay});
+        QObject::connect(&win, &jome::QJomeWindow::hidden, &releaseTimer,
+                         qOverload<>(&QTimer::start));
+        QObject::connect(&win, &jome::QJomeWindow::shown,
+                         [&releaseTimer, &released, &releasedRss]() {
+            releaseTimer.stop();
+
+            if (released) {
+                // showEvent() rebuilt it
+                reportMemTransition("rebuilt the emoji grid", releasedRss, residentSetSizeMib());
+                released = false;
+            }
+        });
+    }
+
+    QObject::connect(&releaseTimer, &QTimer::timeout,
+                     [&win, &stats, &released, &releasedRss]() {
+        const auto rssBefore = residentSetSizeMib();
+
+        win.release();
+        QPixmapCache::clear();
+
+#ifdef __GLIBC__
+        // give the freed heap pages back to the system
+        malloc_trim(0);
+#endif
+
+        released = true;
+        releasedRss = residentSetSizeMib();
+        stats.increment(jome::Stats::Counter::Releases);
+        reportMemTransition("released the emoji grid and images", rssBefore, releasedRss);
+    });
+
     // `QJomeWindow::cancelled` signal
-    QObject::connect(&win, &jome::QJomeWindow::cancelled, [&app, &server, &db]() {
+    QObject::connect(&win, &jome::QJomeWindow::cancelled, [&app, &server, &stats]() {
+        stats.increment(jome::Stats::Counter::Cancels);
+
         if (server) {
             // reply to the client at least
             server->sendToClient("");
+            server->publishEvent(jome::QJomeServer::Event::Cancel);
         }
 
         if (!server) {
             // TODO: make sure the message is sent before quitting
-            QTimer::singleShot(0, [&app, &db]() {
-                jome::updateSettings(db);
+            QTimer::singleShot(0, [&app]() {
                 app.exit(1);
             });
         }
@@ -344,15 +671,31 @@ int main(int argc, char ** const argv)
 
     // `QJomeWindow::emojiChosen` signal
     QObject::connect(&win, &jome::QJomeWindow::emojiChosen,
-                     [&](const auto& emoji, const auto& skinTone, const bool removeVs16) {
+                     [&](const auto& emoji, const auto& skinTone, const bool removeVs16,
+                         const QString& findQuery) {
         // format emoji
-        const auto emojiStr = formatEmoji(emoji, skinTone, params.defSkinTone, params.fmt,
-                                          params.cpPrefix, params.noNewline || params.cmd,
-                                          removeVs16 || params.removeVs16);
+        const auto emojiStr = jome::formatEmoji(emoji, skinTone, params.defSkinTone, params.fmt,
+                                                params.cpPrefix, params.noNewline || params.cmd,
+                                                removeVs16 || params.removeVs16);
+
+        // effective skin tone of the accepted emoji
+        std::optional<jome::Emoji::SkinTone> realSkinTone;
+
+        if (emoji.hasSkinToneSupport()) {
+            realSkinTone = skinTone ? skinTone :
+                           curPickReq.skinTone ? curPickReq.skinTone : params.defSkinTone;
+        }
+
+        stats.countAccept(realSkinTone);
 
         if (server) {
-            // send formatted emoji to connected client
-            server->sendToClient(emojiStr);
+            // send emoji formatted as requested to connected client
+            server->sendToClient(formatEmojiForReq(emoji, skinTone, false, removeVs16, params,
+                                                   curPickReq));
+
+            // notify subscribers
+            server->publishEvent(jome::QJomeServer::Event::Accept, emoji.str(realSkinTone),
+                                 emoji.name());
         }
 
         // always print the formatted emoji
@@ -364,15 +707,13 @@ int main(int argc, char ** const argv)
         }
 
         if (params.cmd) {
-            // execute command in 20 ms
-            QTimer::singleShot(20, &app, [&params, &server, &app, emojiStr]() {
-                execCommand(*params.cmd, emojiStr);
-
-                if (!server && !params.noHide) {
-                    // no server: quit after executing the command
-                    QTimer::singleShot(0, &app, &QApplication::quit);
-                }
-            });
+            if (params.noHide) {
+                // the window stays: run the command now
+                runCmd(cmdArgs(emojiStr));
+            } else {
+                // run the command once the window is hidden
+                pendingCmdArgs = cmdArgs(emojiStr);
+            }
         } else {
             if (!server && !params.noHide) {
                 // no server: quit now
@@ -385,17 +726,22 @@ int main(int argc, char ** const argv)
             win.hide();
         }
 
+        // add emoji as recent emoji, learning the find terms
+        const auto findTerms = jome::EmojiDb::findTerms(findQuery);
+
+        db->addRecentEmoji(emoji, findTerms);
+
         /*
-         * Update recent emojis from settings first as it's possible
-         * that another jome instance changed them.
+         * Log it after all the output above: the writer thread of the
+         * log does the disk I/O.
          */
-        jome::updateRecentEmojisFromSettings(db);
-
-        // add emoji as recent emoji
-        db.addRecentEmoji(emoji);
+        if (db->recentEmojisCat()) {
+            recentLog.append(emoji.str().toStdString(), findTerms.toStdString());
+        }
 
-        // DB changed: update settings accordingly
-        jome::updateSettings(db);
+        if (server) {
+            server->publishEvent(jome::QJomeServer::Event::RecentChanged);
+        }
 
         if (server || params.noHide) {
             /*
@@ -403,35 +749,217 @@ int main(int argc, char ** const argv)
              * event handler which is currently using an emoji graphics
              * item, so we cannot delete it.
              */
-            QTimer::singleShot(0, &win, &jome::QJomeWindow::emojiDbChanged);
+            QTimer::singleShot(0, &win, &jome::QJomeWindow::recentEmojisChanged);
         }
     });
 
+    /*
+     * Reload the "Recent" category when another jome process changes
+     * the recent emoji log, coalescing bursts of changes.
+     */
+    QFileSystemWatcher recentLogWatcher;
+    QTimer recentLogReloadTimer;
+
+    recentLogReloadTimer.setSingleShot(true);
+    recentLogReloadTimer.setInterval(50);
+
+    if (db->recentEmojisCat()) {
+        recentLogWatcher.addPath(QString::fromStdString(recentLog.watchPath()));
+    }
+
+    QObject::connect(&recentLogWatcher, &QFileSystemWatcher::fileChanged,
+                     &recentLogReloadTimer, [&recentLogWatcher,
+                                             &recentLogReloadTimer](const QString& path) {
+        if (!recentLogWatcher.files().contains(path)) {
+            // replaced: watch the new file
+            recentLogWatcher.addPath(path);
+        }
+
+        recentLogReloadTimer.start();
+    });
+
+    QObject::connect(&recentLogReloadTimer, &QTimer::timeout, [&win, &db, &recentLog, &server]() {
+        if (!jome::updateRecentEmojisFromLog(*db, recentLog)) {
+            // this process wrote it, or same recent emojis
+            return;
+        }
+
+        win.recentEmojisChanged();
+
+        if (server) {
+            server->publishEvent(jome::QJomeServer::Event::RecentChanged);
+        }
+    });
+
+    // emoji database and user-defined keyword reloaders (server mode)
+    std::unique_ptr<jome::QFileReloader> dbReloader;
+    std::unique_ptr<jome::QFileReloader> userKeywordsReloader;
+
+    // emoji size of the window when the current emoji database build started
+    auto dbReloadEmojiSize = params.emojiSize;
+
     if (params.serverName) {
         // create server
-        server = std::make_unique<jome::QJomeServer>(nullptr, *params.serverName);
+        server = std::make_unique<jome::QJomeServer>(nullptr, *params.serverName, stats);
 
-        // connect `QJomeServer::clientRequested` signal
-        QObject::connect(server.get(), &jome::QJomeServer::clientRequested,
-                         [&server, &win, &db](const jome::QJomeServer::Command cmd) {
-            if (cmd == jome::QJomeServer::Command::Quit) {
-                // reply to client, then quit
-                server->sendToClient("");
+        /*
+         * Reload the emoji database when its data files change or on
+         * `reload` request, keeping the current one if the user emoji
+         * keyword file is invalid.
+         */
+        dbReloader = std::make_unique<jome::QFileReloader>(
+            nullptr, "emoji database",
+            [&createDb, &win, &db, &released,
+             &dbReloadEmojiSize]() -> jome::QFileReloader::Applier {
+                std::shared_ptr<jome::EmojiDb> newDb = createDb(true);
+
+                // most likely needed
+                newDb->emojiPngLocations(dbReloadEmojiSize);
+
+                return [&win, &db, &released, newDb] {
+                    // keep the recent emojis, including the ones not logged yet
+                    newDb->copyRecentEmojis(*db);
+
+                    // the window uses the previous one until it switches
+                    const auto prevDb = db;
+
+                    std::atomic_store(&db, newDb);
+                    win.emojiDb(*newDb);
+
+                    if (!released) {
+                        // otherwise showing the window loads them
+                        win.preloadEmojiImages();
+                    }
+                };
+            },
+            jome::EmojiDb::dataFilePaths(JOME_DATA_DIR), stats
+        );
+
+        // `width=` and zooming change the emoji size of the window
+        QObject::connect(dbReloader.get(), &jome::QFileReloader::aboutToBuild,
+                         [&win, &dbReloadEmojiSize]() {
+            dbReloadEmojiSize = win.emojiSize();
+        });
+
+        /*
+         * Only replace the user-defined keywords of the current emoji
+         * database when the user emoji keyword file changes: this only
+         * takes as long as loading this file.
+         */
+        userKeywordsReloader = std::make_unique<jome::QFileReloader>(
+            nullptr, "user emoji keywords",
+            [&win, &db, &userKeywordsReloader]() -> jome::QFileReloader::Applier {
+                const auto curDb = std::atomic_load(&db);
+                auto userKeywords = curDb->loadUserKeywords(true);
+
+                return [&win, &db, &userKeywordsReloader, curDb,
+                        userKeywords = std::move(userKeywords)] {
+                    if (db != curDb) {
+                        // the emoji database changed meanwhile: load them for the new one
+                        userKeywordsReloader->reload();
+                        return;
+                    }
+
+                    db->userKeywords(userKeywords);
+                    win.userKeywordsChanged();
+                };
+            },
+            {jome::EmojiDb::userEmojisJsonPath()}, stats
+        );
+
+        // `find` requests (server thread)
+        server->findHandler([&params, &db](const jome::QJomeServer::Request& req) {
+            std::vector<const jome::Emoji *> results;
+
+            // keep it while formatting the results
+            const auto curDb = std::atomic_load(&db);
+
+            curDb->findEmojis(req.query, results);
+
+            if (req.limit && results.size() > *req.limit) {
+                results.resize(*req.limit);
+            }
+
+            // one `EMOJI<TAB>NAME` line per result
+            QString output;
 
-                // TODO: make sure the message is sent before quitting
+            for (const auto emoji : results) {
+                output += formatEmojiForReq(*emoji, std::nullopt, true, false, params, req);
+                output += '\t';
+                output += emoji->name();
+                output += '\n';
+            }
+
+            return output;
+        });
+
+        // connect `QJomeServer::clientRequested` signal (queued to this thread)
+        QObject::connect(server.get(), &jome::QJomeServer::clientRequested, &win,
+                         [&win, &db, &recentLog, &curPickReq, &pickRecvTime,
+                          &dbReloader](const jome::QJomeServer::Request& req) {
+            if (req.cmd == jome::QJomeServer::Command::Quit) {
+                // the server already replied to its clients: quit
                 QTimer::singleShot(10, &QApplication::quit);
+            } else if (req.cmd == jome::QJomeServer::Command::Reload) {
+                dbReloader->reload();
             } else {
-                assert(cmd == jome::QJomeServer::Command::Pick);
-                showWindow(win, db);
+                assert(req.cmd == jome::QJomeServer::Command::Pick);
+                curPickReq = req;
+                pickRecvTime = req.recvTime;
+
+                if (req.emojiWidth) {
+                    // requested emoji size, if valid
+                    if (const auto emojiSize = jome::EmojiDb::emojiSizeFromInt(*req.emojiWidth)) {
+                        win.emojiSize(*emojiSize);
+                    }
+                }
+
+                showWindow(win, *db, recentLog);
             }
         });
     }
 
-    if (!server) {
+    if (server) {
+        // run the server on its own thread
+        server->moveToThread(&serverThread);
+        serverThread.start();
+
+        auto listening = false;
+
+        QMetaObject::invokeMethod(server.get(), &jome::QJomeServer::listen,
+                                  Qt::BlockingQueuedConnection, &listening);
+
+        if (!listening) {
+            std::cerr << "Error: cannot listen with server name `" <<
+                         params.serverName->toUtf8().constData() << "`: " <<
+                         server->errorString().toUtf8().constData() << "\n";
+            serverThread.quit();
+            serverThread.wait();
+            return 1;
+        }
+
+        // make the first `pick` request as fast as possible
+        win.preloadEmojiImages();
+
+        if (params.releaseDelay) {
+            // hidden from the start
+            releaseTimer.start();
+        }
+
+        // database, images, and server are ready
+        notifyServerReady(params);
+    } else {
         // direct mode: time to show the window
-        showWindow(win, db);
+        showWindow(win, *db, recentLog);
     }
 
     // start app
-    return app.exec();
+    const auto exitCode = app.exec();
+
+    if (server) {
+        serverThread.quit();
+        serverThread.wait();
+    }
+
+    return exitCode;
 }
@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_PICK_AFFINITY_HPP
+#define _JOME_PICK_AFFINITY_HPP
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "usage-store.hpp"
+
+namespace jome {
+
+/*
+ * Bounded map of find term prefixes to the emojis accepted after
+ * typing them, with exponentially decayed pick counts.
+ *
+ * A prefix is a UTF-8 string of normalized find terms (see
+ * `EmojiDb::findTerms()`) having between `minPrefixLen` and
+ * `maxPrefixLen` codepoints: prefixes() returns the prefixes of
+ * some terms.
+ *
+ * The map keeps the maxPrefixCount() most picked prefixes and, for
+ * each one, the maxPicksPerPrefix() most picked emojis (see
+ * `UsageStore` for the eviction strategy).
+ */
+template <typename EmojiT>
+class PickAffinity final
+{
+public:
+    using Clock = typename UsageStore<EmojiT>::Clock;
+    using Duration = typename UsageStore<EmojiT>::Duration;
+
+public:
+    // minimum and maximum prefix lengths (codepoints)
+    static constexpr std::size_t minPrefixLen = 2;
+    static constexpr std::size_t maxPrefixLen = 16;
+
+public:
+    /*
+     * Builds an empty map of at most `maxPrefixCount` prefixes, each
+     * one having at most `maxPicksPerPrefix` emojis, with the pick
+     * count half-life `halfLife` and the reference time `refTime`.
+     */
+    explicit PickAffinity(const std::size_t maxPrefixCount = 512,
+                          const std::size_t maxPicksPerPrefix = 4,
+                          const Duration halfLife = std::chrono::hours {24 * 14},
+                          const typename Clock::time_point refTime = Clock::now()) :
+        _maxPicksPerPrefix {maxPicksPerPrefix},
+        _prefixes {maxPrefixCount, halfLife, refTime}
+    {
+    }
+
+    /*
+     * Returns the prefixes of the normalized find terms `terms`, the
+     * shortest first.
+     */
+    static std::vector<std::string> prefixes(const std::string& terms)
+    {
+        std::vector<std::string> prefixes;
+        std::size_t len = 0;
+
+        for (std::size_t i = 1; i <= terms.size(); ++i) {
+            if (i < terms.size() && (static_cast<unsigned char>(terms[i]) & 0xc0) == 0x80) {
+                // within a codepoint
+                continue;
+            }
+
+            ++len;
+
+            if (len > maxPrefixLen) {
+                break;
+            }
+
+            // nobody looks up a prefix ending with a space (normalized)
+            if (len >= minPrefixLen && terms[i - 1] != ' ') {
+                prefixes.push_back(terms.substr(0, i));
+            }
+        }
+
+        return prefixes;
+    }
+
+    /*
+     * Adds `count` picks of `emoji` for the prefix `prefix` at the
+     * time `time`.
+     */
+    void add(const std::string& prefix, const EmojiT& emoji, const double count = 1.,
+             const typename Clock::time_point time = Clock::now())
+    {
+        _prefixes.add(prefix, count, time);
+        this->_picksForPrefix(prefix).add(emoji, count, time);
+        this->_sweep();
+    }
+
+    /*
+     * Adds the score `score` (see `UsageStore::score()`) to `emoji` for
+     * the prefix `prefix`, for example to copy a score from another map
+     * having the same reference time and half-life.
+     */
+    void addScore(const std::string& prefix, const EmojiT& emoji, const double score)
+    {
+        _prefixes.score(prefix, _prefixes.score(prefix) + score);
+
+        auto& picks = this->_picksForPrefix(prefix);
+
+        picks.score(emoji, picks.score(emoji) + score);
+    }
+
+    /*
+     * Picks for the prefix `prefix`, or `nullptr` if none.
+     */
+    const UsageStore<EmojiT> *picks(const std::string& prefix) const
+    {
+        const auto it = _picks.find(prefix);
+
+        return it == _picks.end() ? nullptr : &it->second;
+    }
+
+    /*
+     * All the picks, by prefix.
+     */
+    const std::unordered_map<std::string, UsageStore<EmojiT>>& picks() const noexcept
+    {
+        return _picks;
+    }
+
+    std::size_t maxPrefixCount() const noexcept
+    {
+        return _prefixes.maxSize();
+    }
+
+    std::size_t maxPicksPerPrefix() const noexcept
+    {
+        return _maxPicksPerPrefix;
+    }
+
+    Duration halfLife() const noexcept
+    {
+        return _prefixes.halfLife();
+    }
+
+    typename Clock::time_point refTime() const noexcept
+    {
+        return _prefixes.refTime();
+    }
+
+private:
+    UsageStore<EmojiT>& _picksForPrefix(const std::string& prefix)
+    {
+        auto it = _picks.find(prefix);
+
+        if (it == _picks.end()) {
+            it = _picks.emplace(prefix, UsageStore<EmojiT> {
+                _maxPicksPerPrefix, _prefixes.halfLife(), _prefixes.refTime()
+            }).first;
+        }
+
+        return it->second;
+    }
+
+    /*
+     * Removes the picks of the prefixes which `_prefixes` evicted.
+     */
+    void _sweep()
+    {
+        if (_picks.size() <= _prefixes.scores().size()) {
+            return;
+        }
+
+        for (auto it = _picks.begin(); it != _picks.end();) {
+            if (_prefixes.scores().count(it->first) == 0) {
+                it = _picks.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+private:
+    std::size_t _maxPicksPerPrefix;
+
+    // total pick count of each prefix
+    UsageStore<std::string> _prefixes;
+
+    // picks of each prefix
+    std::unordered_map<std::string, UsageStore<EmojiT>> _picks;
+};
+
+} // namespace jome
+
+#endif // _JOME_PICK_AFFINITY_HPP
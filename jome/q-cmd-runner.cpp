@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <iostream>
+
+#include "q-cmd-runner.hpp"
+
+namespace jome {
+
+QCmdRunner::QCmdRunner(QObject * const parent, Stats& stats, const unsigned int maxRunningCount,
+                       const unsigned int maxQueuedCount) :
+    QObject {parent},
+    _stats {&stats},
+    _maxRunningCount {maxRunningCount},
+    _maxQueuedCount {maxQueuedCount}
+{
+}
+
+QCmdRunner::_Cmd QCmdRunner::_cmd(const QString& cmd, const QStringList& args)
+{
+    auto cmdArgs = QProcess::splitCommand(cmd);
+
+    if (cmdArgs.isEmpty()) {
+        return {};
+    }
+
+    _Cmd runCmd;
+
+    runCmd.program = cmdArgs.takeFirst();
+    runCmd.args = cmdArgs + args;
+    return runCmd;
+}
+
+bool QCmdRunner::_reportFinished(const QString& program, const int exitCode,
+                                 const QProcess::ExitStatus exitStatus)
+{
+    if (exitStatus == QProcess::CrashExit) {
+        std::cerr << "Warning: command `" << program.toUtf8().constData() << "` crashed.\n";
+        return false;
+    }
+
+    if (exitCode != 0) {
+        std::cerr << "Warning: command `" << program.toUtf8().constData() <<
+                     "` exited with status " << exitCode << ".\n";
+        return false;
+    }
+
+    return true;
+}
+
+void QCmdRunner::_reportFailedToStart(const QProcess& process)
+{
+    std::cerr << "Warning: cannot start command `" << process.program().toUtf8().constData() <<
+                 "`: " << process.errorString().toUtf8().constData() << ".\n";
+}
+
+bool QCmdRunner::runSync(const QString& cmd, const QStringList& args)
+{
+    const auto runCmd = QCmdRunner::_cmd(cmd, args);
+
+    if (runCmd.program.isEmpty()) {
+        return false;
+    }
+
+    QProcess process;
+
+    process.setProcessChannelMode(QProcess::ForwardedChannels);
+    process.start(runCmd.program, runCmd.args);
+
+    if (!process.waitForStarted(-1)) {
+        QCmdRunner::_reportFailedToStart(process);
+        return false;
+    }
+
+    process.waitForFinished(-1);
+    return QCmdRunner::_reportFinished(runCmd.program, process.exitCode(), process.exitStatus());
+}
+
+void QCmdRunner::run(const QString& cmd, const QStringList& args)
+{
+    auto runCmd = QCmdRunner::_cmd(cmd, args);
+
+    if (runCmd.program.isEmpty()) {
+        if (_runningCount == 0 && _queue.empty()) {
+            emit this->idle();
+        }
+
+        return;
+    }
+
+    if (_runningCount < _maxRunningCount) {
+        this->_start(runCmd);
+        return;
+    }
+
+    if (_queue.size() >= _maxQueuedCount) {
+        std::cerr << "Warning: too many pending commands: not running `" <<
+                     runCmd.program.toUtf8().constData() << "`.\n";
+        _stats->increment(Stats::Counter::CommandFailures);
+        return;
+    }
+
+    _queue.push_back(std::move(runCmd));
+}
+
+void QCmdRunner::_start(const _Cmd& cmd)
+{
+    auto process = new QProcess {this};
+
+    // like `QProcess::execute()`
+    process->setProcessChannelMode(QProcess::ForwardedChannels);
+
+    QObject::connect(process, &QProcess::finished, this,
+                     [this, process](const int exitCode, const QProcess::ExitStatus exitStatus) {
+        this->_processDone(*process,
+                           !QCmdRunner::_reportFinished(process->program(), exitCode, exitStatus));
+    });
+
+    QObject::connect(process, &QProcess::errorOccurred, this,
+                     [this, process](const QProcess::ProcessError error) {
+        // other errors: finished() follows
+        if (error == QProcess::FailedToStart) {
+            QCmdRunner::_reportFailedToStart(*process);
+            this->_processDone(*process, true);
+        }
+    });
+
+    ++_runningCount;
+    _stats->increment(Stats::Counter::Commands);
+    process->start(cmd.program, cmd.args);
+}
+
+void QCmdRunner::_processDone(QProcess& process, const bool failed)
+{
+    if (failed) {
+        _stats->increment(Stats::Counter::CommandFailures);
+    }
+
+    // we're within one of its signal handlers
+    process.deleteLater();
+    --_runningCount;
+
+    if (!_queue.empty()) {
+        const auto cmd = std::move(_queue.front());
+
+        _queue.pop_front();
+        this->_start(cmd);
+        return;
+    }
+
+    if (_runningCount == 0) {
+        emit this->idle();
+    }
+}
+
+} // namespace jome
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_Q_CMD_RUNNER_HPP
+#define _JOME_Q_CMD_RUNNER_HPP
+
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <deque>
+
+#include "stats.hpp"
+
+namespace jome {
+
+/*
+ * Runs external commands asynchronously, without any shell.
+ *
+ * run() splits a command like a shell does (see
+ * `QProcess::splitCommand()`), without any expansion, and appends
+ * arguments to it. The runner runs at most `maxRunningCount` commands
+ * at a time and queues the other ones (FIFO), dropping any new command
+ * beyond `maxQueuedCount` queued ones.
+ *
+ * The runner reports, to the standard error, a command which can't
+ * start, crashes, or exits with a non-zero status. It also counts the
+ * started and failed commands (see `Stats`).
+ *
+ * The runner emits idle() once no command is running or queued anymore.
+ */
+class QCmdRunner final :
+    public QObject
+{
+    Q_OBJECT
+
+public:
+    /*
+     * Builds a command runner, recording statistics into `stats`.
+     */
+    explicit QCmdRunner(QObject *parent, Stats& stats, unsigned int maxRunningCount = 4,
+                        unsigned int maxQueuedCount = 32);
+
+    /*
+     * Queues running the command `cmd` with the additional
+     * arguments `args`.
+     */
+    void run(const QString& cmd, const QStringList& args);
+
+    /*
+     * Runs the command `cmd` with the additional arguments `args` and
+     * waits for it to finish (blocking), returning true on success.
+     */
+    static bool runSync(const QString& cmd, const QStringList& args);
+
+signals:
+    /*
+     * No command is running or queued anymore.
+     */
+    void idle();
+
+private:
+    /*
+     * Command to run.
+     */
+    struct _Cmd final
+    {
+        QString program;
+        QStringList args;
+    };
+
+private:
+    static _Cmd _cmd(const QString& cmd, const QStringList& args);
+    static bool _reportFinished(const QString& program, int exitCode,
+                                QProcess::ExitStatus exitStatus);
+    static void _reportFailedToStart(const QProcess& process);
+    void _start(const _Cmd& cmd);
+    void _processDone(QProcess& process, bool failed);
+
+private:
+    Stats * const _stats;
+    const unsigned int _maxRunningCount;
+    const unsigned int _maxQueuedCount;
+    unsigned int _runningCount = 0;
+    std::deque<_Cmd> _queue;
+};
+
+} // namespace jome
+
+#endif // _JOME_Q_CMD_RUNNER_HPP
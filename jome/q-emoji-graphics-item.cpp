@@ -15,13 +15,14 @@
 namespace jome {
 
 QEmojiGraphicsItem::QEmojiGraphicsItem(const Emoji& emoji, const QPixmap& pixmap,
-                                       QEmojiGridWidget& emojiGridWidget) :
+                                       QEmojiGridWidget& emojiGridWidget, const bool painted) :
     QGraphicsPixmapItem {pixmap},
     _emoji {&emoji},
     _emojiGridWidget {&emojiGridWidget}
 {
     this->setAcceptHoverEvents(true);
     this->setShapeMode(QGraphicsPixmapItem::BoundingRectShape);
+    this->setFlag(QGraphicsItem::ItemHasNoContents, !painted);
 }
 
 void QEmojiGraphicsItem::mousePressEvent(QGraphicsSceneMouseEvent * const event)
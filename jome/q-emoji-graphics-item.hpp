@@ -30,9 +30,13 @@ public:
     /*
      * Builds an emoji item for the emoji `emoji` using the image
      * `pixmap` within the emoji grid widget `QEmojisWidget`.
+     *
+     * If `painted` is false, then the item doesn't paint anything
+     * itself (its pixmap is part of some category tile) but still
+     * handles hover, click, and context menu events.
      */
     explicit QEmojiGraphicsItem(const Emoji& emoji, const QPixmap& pixmap,
-                                QEmojiGridWidget& emojisWidget);
+                                QEmojiGridWidget& emojisWidget, bool painted = true);
 
     /*
      * Corresponding emoji of this item.
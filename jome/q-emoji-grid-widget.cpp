@@ -15,20 +15,45 @@
 #include <QLabel>
 #include <QGraphicsTextItem>
 #include <QKeyEvent>
+#include <QWheelEvent>
+#include <QPainter>
+#include <QFontMetricsF>
+#include <QElapsedTimer>
+#include <chrono>
 #include <functional>
+#include <algorithm>
+#include <cassert>
 #include "q-emoji-grid-widget.hpp"
 #include "utils.hpp"
 
 namespace jome {
 
-QEmojiGridWidget::QEmojiGridWidget(QWidget * const parent, const EmojiDb& emojiDb, const bool darkBg,
-                                   const bool noCatLabels,
+namespace {
+
+/*
+ * Font of category labels.
+ */
+QFont catLabelFont()
+{
+    return QFont {"Hack, DejaVu Sans Mono, monospace", 10, QFont::Bold};
+}
+
+} // namespace
+
+QEmojiGridWidget::QEmojiGridWidget(QWidget * const parent, const EmojiDb& emojiDb,
+                                   Stats& stats, const EmojiDb::EmojiSize emojiSize,
+                                   const bool darkBg, const bool noCatLabels,
+                                   const bool tileCache, const bool progressiveBuild,
                                    const std::optional<unsigned int> selectedEmojiFlashPeriod) :
     QGraphicsView {parent},
     _emojiDb {&emojiDb},
+    _stats {&stats},
     _emojiImages {emojiDb},
+    _emojiSize {emojiSize},
     _darkBg {darkBg},
-    _noCatLabels {noCatLabels}
+    _noCatLabels {noCatLabels},
+    _tileCache {tileCache},
+    _progressiveBuild {progressiveBuild}
 {
     _allEmojisGraphicsSceneSelectedItem = this->_createSelectedGraphicsItem();
     _findEmojisGraphicsSceneSelectedItem = this->_createSelectedGraphicsItem();
@@ -40,17 +65,39 @@ QEmojiGridWidget::QEmojiGridWidget(QWidget * const parent, const EmojiDb& emojiD
         QObject::connect(&*_selectedItemFlashTimer, &QTimer::timeout,
                          this, &QEmojiGridWidget::_selectedItemFlashTimerTimeout);
         _selectedItemFlashTimer->setInterval(*selectedEmojiFlashPeriod / 2);
-        _selectedItemFlashTimer->start();
+
+        // started by _updateSelectedItemFlashTimer() once visible
     }
 
+    _buildTimer = new QTimer {this};
+    _buildTimer->setInterval(0);
+    QObject::connect(_buildTimer, &QTimer::timeout, this, &QEmojiGridWidget::_buildTimerTimeout);
+    QObject::connect(this->verticalScrollBar(), &QScrollBar::valueChanged, this,
+                     &QEmojiGridWidget::_verticalScrollBarValueChanged);
+
     this->setAlignment(Qt::AlignLeft | Qt::AlignTop);
     this->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
     this->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     this->setFocusPolicy(Qt::NoFocus);
 
+    if (_tileCache) {
+        /*
+         * Tiles are opaque pixmaps without antialiased edges: let the
+         * view scroll the viewport and only repaint what's exposed.
+         */
+        this->setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate);
+        this->setOptimizationFlags(QGraphicsView::DontSavePainterState |
+                                   QGraphicsView::DontAdjustForAntialiasing);
+    }
+
+    this->_updateMinimumWidth();
+}
+
+void QEmojiGridWidget::_updateMinimumWidth()
+{
     // margins, 6 emojis, and scrollbar
     this->setMinimumWidth(static_cast<int>(_gutter * 4 +
-                                           (_emojiDb->emojiSizeInt() + _gutter) * 6 +
+                                           (this->_emojiSizeInt() + _gutter) * 6 +
                                            _gutter + 1));
 }
 
@@ -69,14 +116,64 @@ QEmojiGridWidget::~QEmojiGridWidget()
     }
 }
 
+QGraphicsPixmapItem *QEmojiGridWidget::_curSelectedItem() const
+{
+    if (this->scene() == &_allEmojisGraphicsScene) {
+        return _allEmojisGraphicsSceneSelectedItem;
+    } else {
+        return _findEmojisGraphicsSceneSelectedItem;
+    }
+}
+
 void QEmojiGridWidget::_selectedItemFlashTimerTimeout()
 {
-    if (_allEmojisGraphicsSceneSelectedItem) {
-        _allEmojisGraphicsSceneSelectedItem->setVisible(!_allEmojisGraphicsSceneSelectedItem->isVisible());
+    /*
+     * Only toggle the selection square of the visible scene: this
+     * only damages the bounding rectangle of this square within
+     * the viewport.
+     */
+    const auto selectedItem = this->_curSelectedItem();
+
+    if (selectedItem && selectedItem->scene()) {
+        selectedItem->setVisible(!selectedItem->isVisible());
     }
+}
+
+void QEmojiGridWidget::_updateSelectedItemFlashTimer()
+{
+    if (!_selectedItemFlashTimer) {
+        return;
+    }
+
+    if (this->isVisible() && _selectedEmojiGraphicsItemIndex) {
+        if (!_selectedItemFlashTimer->isActive()) {
+            _selectedItemFlashTimer->start();
+        }
+    } else {
+        /*
+         * Nothing to flash, or nothing to see: stop the timer so that
+         * a hidden jome (server mode) doesn't wake up at all.
+         */
+        _selectedItemFlashTimer->stop();
+    }
+}
+
+void QEmojiGridWidget::showEvent(QShowEvent * const event)
+{
+    QGraphicsView::showEvent(event);
+    this->_updateSelectedItemFlashTimer();
+}
+
+void QEmojiGridWidget::hideEvent(QHideEvent * const event)
+{
+    QGraphicsView::hideEvent(event);
+    this->_updateSelectedItemFlashTimer();
 
-    if (_findEmojisGraphicsSceneSelectedItem) {
-        _findEmojisGraphicsSceneSelectedItem->setVisible(!_findEmojisGraphicsSceneSelectedItem->isVisible());
+    // start the next flashing cycle with a visible selection square
+    if (_selectedEmojiGraphicsItemIndex) {
+        if (const auto selectedItem = this->_curSelectedItem(); selectedItem->scene()) {
+            selectedItem->show();
+        }
     }
 }
 
@@ -85,21 +182,39 @@ void QEmojiGridWidget::_setGraphicsSceneStyle(QGraphicsScene& gs)
     gs.setBackgroundBrush(QColor {_darkBg ? "#404040" : "#d0d0d0"});
 }
 
+QPixmap QEmojiGridWidget::_selectedItemPixmap() const
+{
+    return QPixmap::fromImage(QImage {
+        qFmtFormat("{}/sel{}-{}.png", JOME_DATA_DIR, _darkBg ? "-dark" : "",
+                   this->_emojiSizeInt())
+    });
+}
+
 QGraphicsPixmapItem *QEmojiGridWidget::_createSelectedGraphicsItem()
 {
-    auto graphicsItem = new QGraphicsPixmapItem {
-        QPixmap::fromImage(QImage {
-            qFmtFormat("{}/sel{}-{}.png", JOME_DATA_DIR, _darkBg ? "-dark" : "",
-                       _emojiDb->emojiSizeInt())
-        })
-    };
+    auto graphicsItem = new QGraphicsPixmapItem {this->_selectedItemPixmap()};
 
     graphicsItem->hide();
     graphicsItem->setEnabled(false);
     graphicsItem->setZValue(-5.);
+    graphicsItem->setCacheMode(QGraphicsItem::DeviceCoordinateCache);
     return graphicsItem;
 }
 
+QColor QEmojiGridWidget::_catBgColor(const bool isRecent) const
+{
+    if (isRecent) {
+        return QColor {_darkBg ? "#2d1520" : "#ffe3ec"};
+    } else {
+        return QColor {_darkBg ? "#202020" : "#f8f8f8"};
+    }
+}
+
+QColor QEmojiGridWidget::_catLabelColor(const EmojiCat& cat) const
+{
+    return QColor {cat.isRecent() ? "#ff3366" : (_darkBg ? "#f8f8f8" : "#202020")};
+}
+
 void QEmojiGridWidget::_addRoundedRectToScene(QGraphicsScene& gs, const qreal y, const qreal height,
                                               const bool isRecent)
 {
@@ -111,64 +226,383 @@ void QEmojiGridWidget::_addRoundedRectToScene(QGraphicsScene& gs, const qreal y,
 
     item->setPos(_gutter, y);
     item->setPen(Qt::NoPen);
+    item->setBrush(this->_catBgColor(isRecent));
+    item->setZValue(-2000.);
+}
 
-    if (isRecent) {
-        item->setBrush(QColor {_darkBg ? "#2d1520" : "#ffe3ec"});
+QPixmap QEmojiGridWidget::_renderCatTile(const _CatLayout& layout, const qreal width) const
+{
+    const auto& cat = *layout.cat;
+    const auto dpr = this->devicePixelRatioF();
+    QPixmap pixmap {
+        static_cast<int>(std::ceil(width * dpr)), static_cast<int>(std::ceil(layout.height * dpr))
+    };
+
+    pixmap.setDevicePixelRatio(dpr);
+    pixmap.fill(Qt::transparent);
+
+    QPainter painter {&pixmap};
+
+    // background (same as _addRoundedRectToScene())
+    {
+        QPainterPath path;
+
+        path.addRoundedRect(QRectF {0., 0., width, layout.height}, _gutter, _gutter);
+        painter.fillPath(path, this->_catBgColor(cat.isRecent()));
+    }
+
+    // label (same location as a text item at the same position)
+    if (!_noCatLabels) {
+        const auto font = catLabelFont();
+
+        painter.setRenderHint(QPainter::TextAntialiasing);
+        painter.setFont(font);
+        painter.setPen(this->_catLabelColor(cat));
+        painter.drawText(QPointF {
+            this->_rowFirstEmojiX(_allEmojisGraphicsScene) - _gutter + _catLabelMargin,
+            layout.labelY - layout.y + _catLabelMargin + QFontMetricsF {font}.ascent()
+        }, cat.name());
+    }
+
+    // emoji images, at the positions of their (unpainted) items
+    for (auto i = layout.firstItemIndex; i < layout.firstItemIndex + cat.emojis().size(); ++i) {
+        const auto& item = *_allEmojiGraphicsItems[i];
+
+        painter.drawPixmap(item.pos() - QPointF {_gutter, layout.y}, item.pixmap());
+    }
+
+    return pixmap;
+}
+
+QGraphicsPixmapItem *QEmojiGridWidget::_addCatTileToScene(const _CatLayout& layout)
+{
+    const auto& cat = *layout.cat;
+    const auto width = _allEmojisGraphicsScene.width() - _gutter * 2;
+    const auto dpr = this->devicePixelRatioF();
+    auto& tile = _catTiles[&cat];
+
+    if (tile.pixmap.isNull() || tile.width != width || tile.height != layout.height ||
+            tile.dpr != dpr || tile.emojiSize != _emojiSize || tile.emojis != cat.emojis()) {
+        // layout or emojis changed since the last rendering
+        tile.pixmap = this->_renderCatTile(layout, width);
+        tile.width = width;
+        tile.height = layout.height;
+        tile.dpr = dpr;
+        tile.emojiSize = _emojiSize;
+        tile.emojis = cat.emojis();
+        _stats->increment(Stats::Counter::TileCacheMisses);
     } else {
-        item->setBrush(QColor {_darkBg ? "#202020" : "#f8f8f8"});
+        _stats->increment(Stats::Counter::TileCacheHits);
     }
 
+    const auto item = _allEmojisGraphicsScene.addPixmap(tile.pixmap);
+
+    item->setPos(_gutter, layout.y);
+    item->setEnabled(false);
     item->setZValue(-2000.);
+    return item;
+}
+
+void QEmojiGridWidget::_populateCat(_CatLayout& layout)
+{
+    assert(!layout.populated);
+
+    const auto& cat = *layout.cat;
+
+    if (!_noCatLabels && !_tileCache) {
+        auto item = _allEmojisGraphicsScene.addText(cat.name(), catLabelFont());
+
+        item->setDefaultTextColor(this->_catLabelColor(cat));
+        item->setPos(this->_rowFirstEmojiX(_allEmojisGraphicsScene), layout.labelY);
+    }
+
+    this->_addCatEmojisToScene(layout);
+
+    if (!_tileCache) {
+        this->_addRoundedRectToScene(_allEmojisGraphicsScene, layout.y, layout.height,
+                                     cat.isRecent());
+    }
+
+    layout.populated = true;
+    --_unpopulatedCatCount;
+}
+
+void QEmojiGridWidget::_addCatEmojisToScene(_CatLayout& layout)
+{
+    const auto& cat = *layout.cat;
+
+    {
+        std::vector<QEmojiGraphicsItem *> items;
+        auto y = layout.emojisY;
+
+        items.reserve(cat.emojis().size());
+        this->_addEmojisToGraphicsScene(cat.emojis(), items, _allEmojisGraphicsScene, y,
+                                        !_tileCache);
+        std::copy(items.begin(), items.end(),
+                  _allEmojiGraphicsItems.begin() + layout.firstItemIndex);
+    }
+
+    if (_tileCache) {
+        layout.tileItem = this->_addCatTileToScene(layout);
+    }
+}
+
+void QEmojiGridWidget::refreshRecentCat()
+{
+    const auto layoutIt = std::find_if(_catLayouts.begin(), _catLayouts.end(),
+                                       [](const _CatLayout& layout) {
+        return layout.cat->isRecent();
+    });
+
+    if (layoutIt == _catLayouts.end()) {
+        // not built yet (or no "Recent" category): nothing to refresh
+        return;
+    }
+
+    auto& layout = *layoutIt;
+    const auto newCount = layout.cat->emojis().size();
+    const auto oldCount = layout.itemCount;
+    const auto rowEmojiCount = this->_rowEmojiCount(_allEmojisGraphicsScene);
+
+    if ((newCount + rowEmojiCount - 1) / rowEmojiCount !=
+            (oldCount + rowEmojiCount - 1) / rowEmojiCount) {
+        // the height of the category changes: lay out everything again
+        this->_relayout(this->showingAllEmojis() ?
+                        this->_shiftedSelectedIndex(layout, oldCount, newCount) :
+                        _selectedEmojiGraphicsItemIndex);
+        return;
+    }
+
+    if (newCount == 0) {
+        // was empty and still is
+        return;
+    }
+
+    // remove the previous emojis of the category
+    const auto oldBegin = _allEmojiGraphicsItems.begin() + layout.firstItemIndex;
+
+    if (layout.populated) {
+        for (auto it = oldBegin; it != oldBegin + oldCount; ++it) {
+            delete *it;
+        }
+
+        delete layout.tileItem;
+        layout.tileItem = nullptr;
+    }
+
+    // resize the slots of the category, shifting the next categories
+    const auto delta = static_cast<std::ptrdiff_t>(newCount) -
+                       static_cast<std::ptrdiff_t>(oldCount);
+
+    _allEmojiGraphicsItems.erase(oldBegin, oldBegin + oldCount);
+    _allEmojiGraphicsItems.insert(_allEmojiGraphicsItems.begin() + layout.firstItemIndex,
+                                  newCount, nullptr);
+    layout.itemCount = newCount;
+
+    for (auto it = layoutIt + 1; it != _catLayouts.end(); ++it) {
+        it->firstItemIndex += delta;
+    }
+
+    // same rows: the label and the background stay
+    if (layout.populated) {
+        this->_addCatEmojisToScene(layout);
+    }
+
+    if (!this->showingAllEmojis()) {
+        return;
+    }
+
+    this->_syncCurEmojiGraphicsItems();
+
+    if (!_selectedEmojiGraphicsItemIndex) {
+        return;
+    }
+
+    // keep the selection at the same place, without scrolling
+    const auto index = *this->_shiftedSelectedIndex(layout, oldCount, newCount);
+
+    _selectedEmojiGraphicsItemIndex = index;
+
+    if (const auto item = _curEmojiGraphicsItems[index]) {
+        this->_moveSelectedItemToEmojiItem(*this->_curSelectedItem(), *item);
+        emit this->selectionChanged(&item->emoji());
+    }
+}
+
+std::optional<unsigned int> QEmojiGridWidget::_shiftedSelectedIndex(const _CatLayout& layout,
+                                                                    const std::size_t oldCount,
+                                                                    const std::size_t newCount) const
+{
+    if (!_selectedEmojiGraphicsItemIndex) {
+        return std::nullopt;
+    }
+
+    auto index = static_cast<std::size_t>(*_selectedEmojiGraphicsItemIndex);
+
+    if (index >= layout.firstItemIndex + oldCount) {
+        // same emoji, after the category
+        index = index - oldCount + newCount;
+    } else if (index >= layout.firstItemIndex + newCount) {
+        // within the category: last emoji (first one after it if empty)
+        index = layout.firstItemIndex + std::max<std::size_t>(newCount, 1) - 1;
+    }
+
+    return static_cast<unsigned int>(index);
+}
+
+void QEmojiGridWidget::_populateVisibleCats()
+{
+    const auto top = this->showingAllEmojis() ?
+                     static_cast<qreal>(this->verticalScrollBar()->value()) : 0.;
+    const auto bottom = top + static_cast<qreal>(this->viewport()->height());
+
+    for (auto& layout : _catLayouts) {
+        if (layout.y > bottom) {
+            // sorted by vertical position
+            break;
+        }
+
+        if (!layout.populated && layout.y + layout.height >= top) {
+            this->_populateCat(layout);
+        }
+    }
+}
+
+void QEmojiGridWidget::_syncCurEmojiGraphicsItems()
+{
+    if (this->showingAllEmojis()) {
+        _curEmojiGraphicsItems = _allEmojiGraphicsItems;
+    }
+}
+
+void QEmojiGridWidget::_finishBuild()
+{
+    _buildTimer->stop();
+
+    for (auto& layout : _catLayouts) {
+        if (!layout.populated) {
+            this->_populateCat(layout);
+        }
+    }
+
+    this->_syncCurEmojiGraphicsItems();
+}
+
+void QEmojiGridWidget::_ensureBuilt()
+{
+    if (_unpopulatedCatCount > 0) {
+        this->_finishBuild();
+    }
+}
+
+void QEmojiGridWidget::_buildTimerTimeout()
+{
+    QElapsedTimer elapsedTimer;
+
+    elapsedTimer.start();
+
+    // visible rows first
+    this->_populateVisibleCats();
+
+    // then the next categories until the end of the frame budget
+    for (auto& layout : _catLayouts) {
+        if (elapsedTimer.elapsed() >= _buildChunkBudgetMs) {
+            break;
+        }
+
+        if (!layout.populated) {
+            this->_populateCat(layout);
+        }
+    }
+
+    if (_unpopulatedCatCount == 0) {
+        _buildTimer->stop();
+    }
+
+    this->_syncCurEmojiGraphicsItems();
+}
+
+void QEmojiGridWidget::_verticalScrollBarValueChanged()
+{
+    if (_unpopulatedCatCount > 0 && this->showingAllEmojis()) {
+        // scrolled to categories which aren't built yet: build them now
+        this->_populateVisibleCats();
+        this->_syncCurEmojiGraphicsItems();
+    }
+
+    this->_updateCurCat();
 }
 
 void QEmojiGridWidget::rebuild()
 {
+    const auto startTime = std::chrono::steady_clock::now();
+
     if (_allEmojisGraphicsSceneSelectedItem->scene()) {
         _allEmojisGraphicsScene.removeItem(_allEmojisGraphicsSceneSelectedItem);
     }
 
+    _buildTimer->stop();
     _allEmojisGraphicsScene.clear();
     _allEmojisGraphicsScene.addItem(_allEmojisGraphicsSceneSelectedItem);
     _allEmojiGraphicsItems.clear();
-    _catVertPositions.clear();
+    _catLayouts.clear();
+    _curCat = nullptr;
 
     // scene width: width of this widget minus scrollbar width
     _allEmojisGraphicsScene.setSceneRect(0., 0., static_cast<qreal>(this->width()) - _gutter, 0.);
 
-    const auto rowFirstEmojiX = this->_rowFirstEmojiX(_allEmojisGraphicsScene);
+    /*
+     * Lay out all the categories first: this only needs the number of
+     * emojis of each category, not the graphics items.
+     */
+    const auto rowEmojiCount = this->_rowEmojiCount(_allEmojisGraphicsScene);
+    const auto emojiWidthAndMargin = this->_emojiSizeInt() + _gutter;
+    std::size_t itemCount = 0;
     qreal y = _gutter;
 
     for (const auto& cat : _emojiDb->cats()) {
-        _catVertPositions[cat.get()] = y;
-
-        const auto rectBeginY = y;
+        _CatLayout layout;
 
+        layout.cat = cat.get();
+        layout.y = y;
+        layout.firstItemIndex = itemCount;
+        layout.itemCount = cat->emojis().size();
         y += _gutter;
+        layout.labelY = y;
 
         if (!_noCatLabels) {
-            {
-                auto item = _allEmojisGraphicsScene.addText(cat->name(),
-                                                            QFont {"Hack, DejaVu Sans Mono, monospace",
-                                                                   10, QFont::Bold});
-
-                item->setDefaultTextColor(QColor {
-                    cat->isRecent() ? "#ff3366" : (_darkBg ? "#f8f8f8" : "#202020")
-                });
-                item->setPos(rowFirstEmojiX, y);
-            }
-
             y += 32.;
         }
 
-        this->_addEmojisToGraphicsScene(cat->emojis(), _allEmojiGraphicsItems,
-                                        _allEmojisGraphicsScene, y);
+        layout.emojisY = y;
+
+        // same as _addEmojisToGraphicsScene()
+        {
+            const auto rowCount = (cat->emojis().size() + rowEmojiCount - 1) / rowEmojiCount;
+
+            y += static_cast<qreal>(rowCount) * emojiWidthAndMargin - _gutter;
+        }
+
         y += _gutter;
-        this->_addRoundedRectToScene(_allEmojisGraphicsScene, rectBeginY, y - rectBeginY,
-                                     cat->isRecent());
+        layout.height = y - layout.y;
         y += _gutter;
+        itemCount += cat->emojis().size();
+        _catLayouts.push_back(layout);
     }
 
     _allEmojisGraphicsScene.setSceneRect(0., 0., static_cast<qreal>(this->width()) - _gutter, y);
+    _allEmojiGraphicsItems.assign(itemCount, nullptr);
+    _unpopulatedCatCount = _catLayouts.size();
+
+    if (_progressiveBuild) {
+        // first screenful now, remaining categories from the event loop
+        this->_populateVisibleCats();
+        _buildTimer->start();
+    } else {
+        this->_finishBuild();
+    }
+
+    _stats->record(Stats::Latency::Rebuild, std::chrono::steady_clock::now() - startTime);
 }
 
 void QEmojiGridWidget::showAllEmojis()
@@ -176,6 +610,7 @@ void QEmojiGridWidget::showAllEmojis()
     _curEmojiGraphicsItems = _allEmojiGraphicsItems;
     this->setScene(&_allEmojisGraphicsScene);
     this->_selectEmojiGraphicsItem(0);
+    this->_updateCurCat();
 }
 
 void QEmojiGridWidget::showFindResults(const std::vector<const Emoji *>& results)
@@ -225,8 +660,7 @@ void QEmojiGridWidget::_moveSelectedItemToEmojiItem(QGraphicsPixmapItem& selecte
 void QEmojiGridWidget::_emojiGraphicsItemHoverEntered(const QEmojiGraphicsItem& item)
 {
     // temporarily move the selection rect to the hovered emoji
-    const auto selectedItem = this->showingAllEmojis() ? _allEmojisGraphicsSceneSelectedItem :
-                                                         _findEmojisGraphicsSceneSelectedItem;
+    const auto selectedItem = this->_curSelectedItem();
 
     if (selectedItem && selectedItem->scene()) {
         _savedSelectedItemPos = selectedItem->pos();
@@ -241,8 +675,7 @@ void QEmojiGridWidget::_emojiGraphicsItemHoverEntered(const QEmojiGraphicsItem&
 void QEmojiGridWidget::_emojiGraphicsItemHoverLeaved(const QEmojiGraphicsItem& item)
 {
     // restore the selection rect to its original position
-    const auto selectedItem = this->showingAllEmojis() ? _allEmojisGraphicsSceneSelectedItem :
-                                                         _findEmojisGraphicsSceneSelectedItem;
+    const auto selectedItem = this->_curSelectedItem();
 
     if (selectedItem && selectedItem->scene() && _savedSelectedItemPos) {
         selectedItem->setPos(*_savedSelectedItemPos);
@@ -261,23 +694,14 @@ void QEmojiGridWidget::_emojiGraphicsItemClicked(const QEmojiGraphicsItem& item,
 
 void QEmojiGridWidget::_selectEmojiGraphicsItem(const std::optional<unsigned int> index)
 {
-    const auto selectedItem = std::invoke([this] {
-        if (this->showingAllEmojis()) {
-            return _allEmojisGraphicsSceneSelectedItem;
-        } else {
-            return _findEmojisGraphicsSceneSelectedItem;
-        }
-    });
+    const auto selectedItem = this->_curSelectedItem();
 
     assert(selectedItem);
     assert(selectedItem->scene());
     _selectedEmojiGraphicsItemIndex = index;
 
     if (!index) {
-        if (_selectedItemFlashTimer) {
-            _selectedItemFlashTimer->stop();
-        }
-
+        this->_updateSelectedItemFlashTimer();
         selectedItem->hide();
         emit this->selectionChanged(nullptr);
         return;
@@ -285,14 +709,22 @@ void QEmojiGridWidget::_selectEmojiGraphicsItem(const std::optional<unsigned int
 
     assert(*index < _curEmojiGraphicsItems.size());
 
+    if (!_curEmojiGraphicsItems[*index]) {
+        // not built yet
+        this->_finishBuild();
+    }
+
     const auto& emojiGraphicsItem = *_curEmojiGraphicsItems[*index];
 
     selectedItem->show();
 
+    // restart the flashing cycle from a visible selection square
     if (_selectedItemFlashTimer) {
-        _selectedItemFlashTimer->start();
+        _selectedItemFlashTimer->stop();
     }
 
+    this->_updateSelectedItemFlashTimer();
+
     this->_moveSelectedItemToEmojiItem(*selectedItem, emojiGraphicsItem);
 
     if (*index == 0) {
@@ -310,12 +742,57 @@ void QEmojiGridWidget::_selectEmojiGraphicsItem(const std::optional<unsigned int
 
 void QEmojiGridWidget::scrollToCat(const EmojiCat& cat)
 {
-    if (_catVertPositions.empty()) {
+    const auto it = std::find_if(_catLayouts.begin(), _catLayouts.end(),
+                                 [&cat](const _CatLayout& layout) {
+        return layout.cat == &cat;
+    });
+
+    if (it == _catLayouts.end()) {
         return;
     }
 
-    this->verticalScrollBar()->setValue(static_cast<int>(std::max(0.,
-                                                                  _catVertPositions[&cat] - 8)));
+    /*
+     * The requested category is the current one, even if the view
+     * can't scroll enough to bring it to the top.
+     */
+    _scrollingToCat = true;
+    this->verticalScrollBar()->setValue(static_cast<int>(std::max(0., it->y - _gutter)));
+    _scrollingToCat = false;
+    _curCat = &cat;
+}
+
+const EmojiCat *QEmojiGridWidget::_catAtScrollPos() const
+{
+    if (_catLayouts.empty()) {
+        return nullptr;
+    }
+
+    // last category starting at or above the top of the view
+    const auto y = static_cast<qreal>(this->verticalScrollBar()->value()) + _gutter;
+    auto it = std::upper_bound(_catLayouts.begin(), _catLayouts.end(), y,
+                               [](const qreal y, const _CatLayout& layout) {
+        return y < layout.y;
+    });
+
+    if (it != _catLayouts.begin()) {
+        --it;
+    }
+
+    return it->cat;
+}
+
+void QEmojiGridWidget::_updateCurCat()
+{
+    if (_scrollingToCat || !this->showingAllEmojis()) {
+        return;
+    }
+
+    const auto cat = this->_catAtScrollPos();
+
+    if (cat && cat != _curCat) {
+        _curCat = cat;
+        emit this->currentCatChanged(*cat);
+    }
 }
 
 void QEmojiGridWidget::selectNext(const unsigned int count)
@@ -354,6 +831,9 @@ void QEmojiGridWidget::selectPreviousRow(const unsigned int count)
         return;
     }
 
+    // needs the positions of all the emoji graphics items
+    this->_ensureBuilt();
+
     const auto& selectedEmojiGraphicsItem = *_curEmojiGraphicsItems[*_selectedEmojiGraphicsItemIndex];
     const auto curX = selectedEmojiGraphicsItem.pos().x();
     auto index = *_selectedEmojiGraphicsItemIndex;
@@ -378,6 +858,9 @@ void QEmojiGridWidget::selectNextRow(const unsigned int count)
         return;
     }
 
+    // needs the positions of all the emoji graphics items
+    this->_ensureBuilt();
+
     const auto& selectedEmojiGraphicsItem = *_curEmojiGraphicsItems[*_selectedEmojiGraphicsItemIndex];
     const auto curX = selectedEmojiGraphicsItem.pos().x();
     auto index = *_selectedEmojiGraphicsItemIndex;
@@ -422,10 +905,129 @@ bool QEmojiGridWidget::showingAllEmojis()
 void QEmojiGridWidget::resizeEvent(QResizeEvent * const event)
 {
     QGraphicsView::resizeEvent(event);
+    this->_relayout(_selectedEmojiGraphicsItemIndex);
+}
+
+void QEmojiGridWidget::wheelEvent(QWheelEvent * const event)
+{
+    if (!(event->modifiers() & Qt::ControlModifier)) {
+        _zoomWheelAngleDelta = 0;
+        QGraphicsView::wheelEvent(event);
+        return;
+    }
+
+    // one zoom step per wheel notch, whatever the device resolution
+    _zoomWheelAngleDelta += event->angleDelta().y();
+
+    if (_zoomWheelAngleDelta >= 120) {
+        _zoomWheelAngleDelta = 0;
+        this->zoomIn();
+    } else if (_zoomWheelAngleDelta <= -120) {
+        _zoomWheelAngleDelta = 0;
+        this->zoomOut();
+    }
+
+    event->accept();
+}
+
+void QEmojiGridWidget::emojiSize(const EmojiDb::EmojiSize emojiSize)
+{
+    if (emojiSize == _emojiSize) {
+        return;
+    }
+
+    _emojiSize = emojiSize;
+    _allEmojisGraphicsSceneSelectedItem->setPixmap(this->_selectedItemPixmap());
+    _findEmojisGraphicsSceneSelectedItem->setPixmap(this->_selectedItemPixmap());
+    this->_updateMinimumWidth();
+
+    if (this->scene()) {
+        // already built: lay out again
+        this->_relayout(_selectedEmojiGraphicsItemIndex);
+    }
+}
+
+namespace {
+
+constexpr EmojiDb::EmojiSize emojiSizes[] = {
+    EmojiDb::EmojiSize::Size16,
+    EmojiDb::EmojiSize::Size24,
+    EmojiDb::EmojiSize::Size32,
+    EmojiDb::EmojiSize::Size40,
+    EmojiDb::EmojiSize::Size48,
+};
 
-    // save current index
-    const auto selectedItemIndex = _selectedEmojiGraphicsItemIndex;
+} // namespace
 
+void QEmojiGridWidget::preloadEmojiImages()
+{
+    _emojiImages.preload(_emojiSize);
+}
+
+void QEmojiGridWidget::_clear()
+{
+    _buildTimer->stop();
+
+    const auto clearScene = [](QGraphicsScene& gs, QGraphicsPixmapItem& selectedItem) {
+        if (selectedItem.scene()) {
+            gs.removeItem(&selectedItem);
+        }
+
+        gs.clear();
+        gs.addItem(&selectedItem);
+        selectedItem.hide();
+    };
+
+    clearScene(_allEmojisGraphicsScene, *_allEmojisGraphicsSceneSelectedItem);
+    clearScene(_findEmojisGraphicsScene, *_findEmojisGraphicsSceneSelectedItem);
+
+    _allEmojiGraphicsItems.clear();
+    _curEmojiGraphicsItems.clear();
+    _catLayouts.clear();
+    _catTiles.clear();
+    _curCat = nullptr;
+    _unpopulatedCatCount = 0;
+    _selectedEmojiGraphicsItemIndex = std::nullopt;
+    _savedSelectedItemPos = std::nullopt;
+}
+
+void QEmojiGridWidget::emojiDb(const EmojiDb& emojiDb)
+{
+    // the graphics items and the tiles refer to the previous database
+    this->_clear();
+    _emojiDb = &emojiDb;
+    _emojiImages.emojiDb(emojiDb);
+}
+
+void QEmojiGridWidget::release()
+{
+    this->_clear();
+
+    // not built anymore (see emojiSize())
+    this->setScene(nullptr);
+    _emojiImages.clear();
+}
+
+void QEmojiGridWidget::zoomIn()
+{
+    const auto it = std::find(std::begin(emojiSizes), std::end(emojiSizes), _emojiSize);
+
+    if (it + 1 != std::end(emojiSizes)) {
+        this->emojiSize(*(it + 1));
+    }
+}
+
+void QEmojiGridWidget::zoomOut()
+{
+    const auto it = std::find(std::begin(emojiSizes), std::end(emojiSizes), _emojiSize);
+
+    if (it != std::begin(emojiSizes)) {
+        this->emojiSize(*(it - 1));
+    }
+}
+
+void QEmojiGridWidget::_relayout(std::optional<unsigned int> selectedItemIndex)
+{
     // rebuild the "all emojis" view
     this->rebuild();
 
@@ -443,6 +1045,12 @@ void QEmojiGridWidget::resizeEvent(QResizeEvent * const event)
         this->showFindResults(results);
     }
 
+    if (selectedItemIndex && *selectedItemIndex >= _curEmojiGraphicsItems.size()) {
+        // fewer emojis now: last one, if any
+        selectedItemIndex = _curEmojiGraphicsItems.empty() ? std::nullopt :
+                            std::make_optional<unsigned int>(_curEmojiGraphicsItems.size() - 1);
+    }
+
     this->_selectEmojiGraphicsItem(selectedItemIndex);
 }
 
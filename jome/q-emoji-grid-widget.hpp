@@ -16,11 +16,14 @@
 #include <QGraphicsView>
 #include <QTimer>
 #include <optional>
+#include <vector>
+#include <unordered_map>
 #include <cmath>
 
 #include "emoji-db.hpp"
 #include "emoji-images.hpp"
 #include "q-emoji-graphics-item.hpp"
+#include "stats.hpp"
 
 namespace jome {
 
@@ -35,6 +38,10 @@ namespace jome {
  * to present. It handles resize events gracefully, ensuring a minimum
  * width of six emojis plus any required padding.
  *
+ * Change the emoji size with emojiSize(), zoomIn(), and zoomOut(), or
+ * with Ctrl+wheel: this only lays out the emojis again, reusing the
+ * images of previously used sizes (see `EmojiImages`).
+ *
  * Behind the scenes, an emoji grid widget is a Qt graphics view. Each
  * emoji is a graphics item of class `QEmojiGraphicsItem` simply showing
  * a pixmap which is a section of the selected big emoji image (see
@@ -42,6 +49,19 @@ namespace jome {
  * graphics items (`_allEmojisGraphicsSceneSelectedItem`
  * and `_findEmojisGraphicsSceneSelectedItem`).
  *
+ * With the tile cache enabled, each category panel of the "all emojis"
+ * scene (background, label, and emoji images) is rendered once into a
+ * pixmap tile which is only rendered again when the layout or the
+ * emojis of the category change. The emoji graphics items then don't
+ * paint anything themselves: they only handle user events.
+ *
+ * With the progressive build mode, rebuild() lays out all the
+ * categories, but only creates the graphics items of the visible ones.
+ * A zero-interval timer then creates the remaining ones, category by
+ * category, without exceeding some time budget per event loop
+ * iteration, visible categories first. Operations which need all the
+ * graphics items, like row navigation, finish the build synchronously.
+ *
  * When you build an emoji grid widget, it shows all the emojis by
  * category by default. This is equivalent to calling showAllEmojis(),
  * and showingAllEmojis() returns true. Show find results with a given
@@ -52,6 +72,10 @@ namespace jome {
  * Scroll to a specific category when showing all the emojis
  * with scrollToCat().
  *
+ * The categories of the "all emojis" scene are laid out in a vector
+ * sorted by vertical position (`_catLayouts`): mapping the current
+ * scroll position to the current category is a binary search.
+ *
  * Your signals of interest are:
  *
  * selectionChanged():
@@ -65,6 +89,11 @@ namespace jome {
  *
  * emojiClicked():
  *     The user clicked a given emoji.
+ *
+ * currentCatChanged():
+ *     The category at the top of the "all emojis" view changed,
+ *     either because the user scrolled or because the view was
+ *     rebuilt. Not emitted by scrollToCat().
  */
 class QEmojiGridWidget final :
     public QGraphicsView
@@ -74,15 +103,14 @@ class QEmojiGridWidget final :
     friend class QEmojiGraphicsItem;
 
 public:
-    using CatVerticalPositions = std::unordered_map<const EmojiCat *, qreal>;
-
-public:
-    explicit QEmojiGridWidget(QWidget *parent, const EmojiDb& emojiDb,
-                              bool darkBg, bool noCatLabels,
+    explicit QEmojiGridWidget(QWidget *parent, const EmojiDb& emojiDb, Stats& stats,
+                              EmojiDb::EmojiSize emojiSize, bool darkBg, bool noCatLabels,
+                              bool tileCache, bool progressiveBuild,
                               std::optional<unsigned int> selectedEmojiFlashPeriod);
 
     ~QEmojiGridWidget();
     void rebuild();
+    void refreshRecentCat();
     void showAllEmojis();
     void showFindResults(const std::vector<const Emoji *>& results);
     void selectNext(unsigned int count = 1);
@@ -93,16 +121,96 @@ public:
     void selectLast();
     void scrollToCat(const EmojiCat& cat);
     bool showingAllEmojis();
+    void emojiSize(EmojiDb::EmojiSize emojiSize);
+    void zoomIn();
+    void zoomOut();
+    void preloadEmojiImages();
+
+    /*
+     * Makes this widget present the emojis of `emojiDb` from now on,
+     * removing all the current emojis: call rebuild() and then
+     * showAllEmojis() or showFindResults() afterwards.
+     */
+    void emojiDb(const EmojiDb& emojiDb);
+
+    /*
+     * Removes all the current emojis and unloads all the emoji images
+     * to release memory: call rebuild() and then showAllEmojis() or
+     * showFindResults() afterwards.
+     */
+    void release();
+
+    EmojiDb::EmojiSize emojiSize() const noexcept
+    {
+        return _emojiSize;
+    }
 
 signals:
     void selectionChanged(const Emoji *emoji);
     void emojiHoverEntered(const Emoji& emoji);
     void emojiHoverLeaved(const Emoji& emoji);
     void emojiClicked(const Emoji& emoji, bool withShift);
+    void currentCatChanged(const EmojiCat& cat);
+
+private:
+    /*
+     * Layout of a category within the "all emojis" scene.
+     */
+    struct _CatLayout final
+    {
+        const EmojiCat *cat;
+
+        // top of the category panel, and its height
+        qreal y;
+        qreal height;
+
+        // top of the label and of the first row of emojis
+        qreal labelY;
+        qreal emojisY;
+
+        // index of the first emoji within `_allEmojiGraphicsItems`
+        std::size_t firstItemIndex;
+
+        // number of emojis when laid out
+        std::size_t itemCount;
+
+        // rendered tile item, if populated (`-T` option)
+        QGraphicsPixmapItem *tileItem = nullptr;
+
+        // true if the graphics items of the category exist
+        bool populated = false;
+    };
+
+    /*
+     * Rendered category panel of the "all emojis" scene.
+     *
+     * The other members are what `pixmap` depends on.
+     */
+    struct _CatTile final
+    {
+        QPixmap pixmap;
+        qreal width;
+        qreal height;
+        qreal dpr;
+        EmojiDb::EmojiSize emojiSize;
+        std::vector<const Emoji *> emojis;
+    };
 
 private:
     void resizeEvent(QResizeEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
     void _selectEmojiGraphicsItem(std::optional<unsigned int> index);
+    QGraphicsPixmapItem *_curSelectedItem() const;
+    void _updateSelectedItemFlashTimer();
+    void _relayout(std::optional<unsigned int> selectedItemIndex);
+    std::optional<unsigned int> _shiftedSelectedIndex(const _CatLayout& layout,
+                                                      std::size_t oldCount,
+                                                      std::size_t newCount) const;
+    void _clear();
+    void _updateMinimumWidth();
+    QPixmap _selectedItemPixmap() const;
     QGraphicsPixmapItem *_createSelectedGraphicsItem();
     void _setGraphicsSceneStyle(QGraphicsScene& gs);
     void _moveSelectedItemToEmojiItem(QGraphicsPixmapItem& selectedItem,
@@ -112,33 +220,70 @@ private:
     void _emojiGraphicsItemClicked(const QEmojiGraphicsItem& item, bool withShift);
     void _addRoundedRectToScene(QGraphicsScene& gs, qreal y, qreal height,
                                 bool isRecent = false);
+    QGraphicsPixmapItem *_addCatTileToScene(const _CatLayout& layout);
+    void _addCatEmojisToScene(_CatLayout& layout);
+    QPixmap _renderCatTile(const _CatLayout& layout, qreal width) const;
+    void _populateCat(_CatLayout& layout);
+    void _populateVisibleCats();
+    void _syncCurEmojiGraphicsItems();
+    void _finishBuild();
+    void _ensureBuilt();
+    const EmojiCat *_catAtScrollPos() const;
+    void _updateCurCat();
+    QColor _catBgColor(bool isRecent) const;
+    QColor _catLabelColor(const EmojiCat& cat) const;
 
 private slots:
     void _selectedItemFlashTimerTimeout();
+    void _buildTimerTimeout();
+    void _verticalScrollBarValueChanged();
 
 private:
+    unsigned int _emojiSizeInt() const noexcept
+    {
+        return EmojiDb::emojiSizeInt(_emojiSize);
+    }
+
     qreal _rowFirstEmojiX(const QGraphicsScene& gs) const
     {
         const auto availWidth = gs.width() - _gutter * 4;
-        const auto rowEmojiCount = std::floor((availWidth + _gutter) / (_emojiDb->emojiSizeInt() + _gutter));
-        const auto emojisTotalWidth = rowEmojiCount * _emojiDb->emojiSizeInt() +
+        const auto rowEmojiCount = std::floor((availWidth + _gutter) / (this->_emojiSizeInt() + _gutter));
+        const auto emojisTotalWidth = rowEmojiCount * this->_emojiSizeInt() +
                                       (rowEmojiCount - 1) * _gutter;
 
         return std::floor((availWidth - emojisTotalWidth) / 2.) + _gutter * 2;
     }
 
+    /*
+     * Number of emojis per row, as placed by
+     * _addEmojisToGraphicsScene().
+     */
+    std::size_t _rowEmojiCount(const QGraphicsScene& gs) const
+    {
+        const auto rowFirstEmojiX = this->_rowFirstEmojiX(gs);
+        const auto emojiWidthAndMargin = this->_emojiSizeInt() + _gutter;
+        std::size_t count = 1;
+
+        while ((static_cast<qreal>(count) + 1.) * emojiWidthAndMargin + rowFirstEmojiX <
+                gs.width()) {
+            ++count;
+        }
+
+        return count;
+    }
+
     template <typename ContainerT>
     void _addEmojisToGraphicsScene(const ContainerT& emojis,
                                    std::vector<QEmojiGraphicsItem *>& emojiGraphicsItems,
-                                   QGraphicsScene& gs, qreal& y)
+                                   QGraphicsScene& gs, qreal& y, const bool painted = true)
     {
         qreal col = 0.;
         const auto rowFirstEmojiX = this->_rowFirstEmojiX(gs);
-        const auto emojiWidthAndMargin = _emojiDb->emojiSizeInt() + _gutter;
+        const auto emojiWidthAndMargin = this->_emojiSizeInt() + _gutter;
 
         for (auto& emoji : emojis) {
             auto emojiGraphicsItem = new QEmojiGraphicsItem {
-                *emoji, _emojiImages.pixmapForEmoji(*emoji), *this
+                *emoji, _emojiImages.pixmapForEmoji(*emoji, _emojiSize), *this, painted
             };
 
             emojiGraphicsItems.push_back(emojiGraphicsItem);
@@ -163,21 +308,53 @@ private:
     // padding used throughout
     static constexpr qreal _gutter = 8.;
 
+    // document margin of a category label text item
+    static constexpr qreal _catLabelMargin = 4.;
+
+    // progressive build: time budget (ms) per event loop iteration
+    static constexpr qint64 _buildChunkBudgetMs = 8;
+
 private:
     // linked emoji database
-    const EmojiDb * const _emojiDb;
+    const EmojiDb *_emojiDb;
+
+    // runtime statistics
+    Stats * const _stats;
 
     // emoji images
-    const EmojiImages _emojiImages;
+    EmojiImages _emojiImages;
+
+    // current emoji size
+    EmojiDb::EmojiSize _emojiSize;
+
+    // accumulated Ctrl+wheel angle delta
+    int _zoomWheelAngleDelta = 0;
 
     // graphics scenes for all emojis and find results
     QGraphicsScene _allEmojisGraphicsScene;
     QGraphicsScene _findEmojisGraphicsScene;
 
-    // vertical positions for each category
-    CatVerticalPositions _catVertPositions;
+    /*
+     * Layouts of the categories of the "all emojis" scene, in order,
+     * therefore sorted by vertical position.
+     */
+    std::vector<_CatLayout> _catLayouts;
+
+    // category at the top of the "all emojis" view (last emitted)
+    const EmojiCat *_curCat = nullptr;
+
+    // true while scrollToCat() is scrolling
+    bool _scrollingToCat = false;
 
-    // current graphics items for all emojis and find results
+    // number of categories of `_catLayouts` which aren't populated
+    std::size_t _unpopulatedCatCount = 0;
+
+    /*
+     * Current graphics items for all emojis and find results.
+     *
+     * During a progressive build, some entries of
+     * `_allEmojiGraphicsItems` are still null.
+     */
     std::vector<QEmojiGraphicsItem *> _allEmojiGraphicsItems;
     std::vector<QEmojiGraphicsItem *> _curEmojiGraphicsItems;
 
@@ -188,7 +365,12 @@ private:
     QGraphicsPixmapItem *_allEmojisGraphicsSceneSelectedItem = nullptr;
     QGraphicsPixmapItem *_findEmojisGraphicsSceneSelectedItem = nullptr;
 
-    // timer to make the selection square flash if requested
+    /*
+     * Timer to make the selection square flash if requested.
+     *
+     * Only active while this widget is visible and there's a
+     * selected emoji.
+     */
     QTimer *_selectedItemFlashTimer = nullptr;
 
     // true to use a dark background
@@ -197,6 +379,18 @@ private:
     // true to hide category labels when showing all emojis
     bool _noCatLabels;
 
+    // true to render category panels as cached pixmap tiles
+    bool _tileCache;
+
+    // cached category panel tiles
+    std::unordered_map<const EmojiCat *, _CatTile> _catTiles;
+
+    // true to build the "all emojis" scene progressively
+    bool _progressiveBuild;
+
+    // timer of the progressive build
+    QTimer *_buildTimer = nullptr;
+
     // saved selection rect state during hover
     std::optional<QPointF> _savedSelectedItemPos;
     bool _savedSelectedItemVisible = false;
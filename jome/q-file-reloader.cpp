@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <exception>
+#include <iostream>
+#include <QDir>
+#include <QFileInfo>
+
+#include "q-file-reloader.hpp"
+
+namespace jome {
+
+QFileReloader::QFileReloader(QObject * const parent, QString what, Builder builder,
+                             const QStringList& paths, Stats& stats) :
+    QObject {parent},
+    _what {std::move(what)},
+    _builder {std::move(builder)},
+    _paths {paths},
+    _stats {&stats},
+    _lastFileStates {this->_fileStates()}
+{
+    // coalesce bursts of changes (editors, package managers)
+    _changeTimer.setSingleShot(true);
+    _changeTimer.setInterval(_changeDelayMs);
+    QObject::connect(&_watcher, &QFileSystemWatcher::fileChanged, this, [this] {
+        _changeTimer.start();
+    });
+    QObject::connect(&_watcher, &QFileSystemWatcher::directoryChanged, this, [this] {
+        _changeTimer.start();
+    });
+    QObject::connect(&_changeTimer, &QTimer::timeout, this,
+                     &QFileReloader::_changeTimerTimeout);
+    this->_watch();
+}
+
+QFileReloader::~QFileReloader()
+{
+    if (_buildThread) {
+        // the builder may use objects which are about to be destroyed
+        _buildThread->wait();
+        delete _buildThread;
+    }
+}
+
+std::vector<QFileReloader::_FileState> QFileReloader::_fileStates() const
+{
+    std::vector<_FileState> states;
+
+    for (const auto& path : _paths) {
+        const QFileInfo info {path};
+
+        states.push_back({info.exists(), info.lastModified(), info.size()});
+    }
+
+    return states;
+}
+
+void QFileReloader::_watch()
+{
+    for (const auto& path : _paths) {
+        // watch again a replaced file
+        if (QFileInfo::exists(path) && !_watcher.files().contains(path)) {
+            _watcher.addPath(path);
+        }
+
+        // notices a created or replaced file
+        const auto dirPath = QFileInfo {path}.absolutePath();
+
+        if (QDir {dirPath}.exists() && !_watcher.directories().contains(dirPath)) {
+            _watcher.addPath(dirPath);
+        }
+    }
+}
+
+void QFileReloader::_changeTimerTimeout()
+{
+    this->_watch();
+
+    if (this->_fileStates() == _lastFileStates) {
+        // another file of a watched directory changed
+        return;
+    }
+
+    this->reload();
+}
+
+void QFileReloader::reload()
+{
+    if (_buildThread) {
+        // the current build may have missed the latest changes
+        _buildPending = true;
+        return;
+    }
+
+    this->_startBuild();
+}
+
+void QFileReloader::_startBuild()
+{
+    _lastFileStates = this->_fileStates();
+    _stats->increment(Stats::Counter::Reloads);
+
+    // starting the build thread publishes what the slots prepare
+    emit this->aboutToBuild();
+
+    const auto build = std::make_shared<_Build>();
+
+    _buildThread = QThread::create([builder = _builder, build] {
+        try {
+            build->applier = builder();
+        } catch (const std::exception& exc) {
+            build->error = exc.what();
+        }
+    });
+
+    // queued: `finished()` is emitted from the build thread
+    QObject::connect(_buildThread, &QThread::finished, this, [this, build] {
+        _buildThread->deleteLater();
+        _buildThread = nullptr;
+        this->_buildDone(*build);
+    });
+
+    // don't compete with the GUI thread
+    _buildThread->start(QThread::LowPriority);
+}
+
+void QFileReloader::_buildDone(const _Build& build)
+{
+    if (build.applier) {
+        build.applier();
+    } else {
+        std::cerr << "Warning: cannot reload the " << _what.toUtf8().constData() <<
+                     " (keeping the current version): " << build.error << ".\n";
+        _stats->increment(Stats::Counter::ReloadFailures);
+    }
+
+    if (_buildPending) {
+        _buildPending = false;
+        this->_startBuild();
+    }
+}
+
+} // namespace jome
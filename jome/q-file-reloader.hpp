@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_Q_FILE_RELOADER_HPP
+#define _JOME_Q_FILE_RELOADER_HPP
+
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+#include <QTimer>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "stats.hpp"
+
+namespace jome {
+
+/*
+ * Rebuilds something from some files when they change or on demand.
+ *
+ * A file reloader watches some files as well as their directories, as
+ * editors often replace a file instead of writing it. Once the
+ * modification time, the size, or the existence of a watched file
+ * changes and nothing else happens for a short while, or when you call
+ * reload(), the reloader calls its builder on a dedicated thread, and
+ * then calls the applier which the builder returns from its own thread.
+ *
+ * If the builder throws, then the reloader prints a warning about its
+ * "what" string and doesn't apply anything: keep using the current
+ * version.
+ *
+ * A reloader runs a single build at a time: a reload request during a
+ * build starts another build once it's done.
+ *
+ * The reloader counts the builds and the failed ones (see `Stats`).
+ *
+ * aboutToBuild() signal:
+ *     The reloader is about to call its builder: a directly connected
+ *     slot may prepare, from the thread of the reloader, what the
+ *     builder reads.
+ */
+class QFileReloader final :
+    public QObject
+{
+    Q_OBJECT
+
+public:
+    /*
+     * Applies the outcome of a build, called from the thread of
+     * the reloader.
+     */
+    using Applier = std::function<void ()>;
+
+    /*
+     * Builds a new version, called from the build thread, and returns
+     * how to apply it.
+     */
+    using Builder = std::function<Applier ()>;
+
+public:
+    /*
+     * Builds a reloader which watches the files `paths` and builds new
+     * versions of `what` (for warnings) with `builder`, recording
+     * statistics into `stats`.
+     */
+    explicit QFileReloader(QObject *parent, QString what, Builder builder,
+                           const QStringList& paths, Stats& stats);
+
+    /*
+     * Waits for the current build, if any.
+     */
+    ~QFileReloader();
+
+    /*
+     * Builds a new version, even if no watched file changed.
+     */
+    void reload();
+
+signals:
+    void aboutToBuild();
+
+private:
+    /*
+     * State of a watched file.
+     */
+    struct _FileState final
+    {
+        bool operator==(const _FileState& other) const noexcept
+        {
+            return exists == other.exists && lastModified == other.lastModified &&
+                   size == other.size;
+        }
+
+        bool operator!=(const _FileState& other) const noexcept
+        {
+            return !(*this == other);
+        }
+
+        bool exists;
+        QDateTime lastModified;
+        qint64 size;
+    };
+
+    /*
+     * Outcome of a build.
+     */
+    struct _Build final
+    {
+        Applier applier;
+        std::string error;
+    };
+
+private:
+    std::vector<_FileState> _fileStates() const;
+    void _watch();
+    void _startBuild();
+    void _buildDone(const _Build& build);
+
+private slots:
+    void _changeTimerTimeout();
+
+private:
+    // quiet period (ms) before checking the watched files
+    static constexpr int _changeDelayMs = 250;
+
+private:
+    const QString _what;
+    const Builder _builder;
+    const QStringList _paths;
+    Stats * const _stats;
+    QFileSystemWatcher _watcher;
+    QTimer _changeTimer;
+
+    // states of `_paths` when the last build started
+    std::vector<_FileState> _lastFileStates;
+
+    // current build thread, if any
+    QThread *_buildThread = nullptr;
+
+    // true to start another build after the current one
+    bool _buildPending = false;
+};
+
+} // namespace jome
+
+#endif // _JOME_Q_FILE_RELOADER_HPP
@@ -6,85 +6,574 @@
  */
 
 #include <cassert>
+#include <algorithm>
+#include <vector>
+#include <QTimer>
 
 #include "q-jome-server.hpp"
 
 namespace jome {
 
-QJomeServer::QJomeServer(QObject * const parent, const QString& name) :
-    QObject {parent}
+QJomeServer::QJomeServer(QObject * const parent, const QString& name, Stats& stats) :
+    QObject {parent},
+    _name {name},
+    _stats {&stats}
 {
     QObject::connect(&_server, &QLocalServer::newConnection, this, &QJomeServer::_newConnection);
-    _server.listen(name);
+}
+
+bool QJomeServer::listen()
+{
+    return _server.listen(_name);
 }
 
 void QJomeServer::_newConnection()
 {
-    auto socket = _server.nextPendingConnection();
+    while (const auto socket = _server.nextPendingConnection()) {
+        _clients.emplace(socket, _Client {});
+        QObject::connect(socket, &QLocalSocket::disconnected, this, [this, socket] {
+            this->_socketDisconnected(*socket);
+        });
+        QObject::connect(socket, &QLocalSocket::disconnected, socket,
+                         &QLocalSocket::deleteLater);
+        QObject::connect(socket, &QLocalSocket::readyRead, this, [this, socket] {
+            this->_socketReadyRead(*socket);
+        });
+    }
+}
+
+void QJomeServer::_socketDisconnected(QLocalSocket& socket)
+{
+    _clients.erase(&socket);
 
-    if (!socket) {
+    if (_pickQueue.empty()) {
         return;
     }
 
-    QObject::connect(socket, &QLocalSocket::disconnected, socket, &QLocalSocket::deleteLater);
+    auto it = _pickQueue.begin();
 
-    if (_socket) {
-        // we should probably be able to handle more than one
-        socket->close();
-        return;
+    if (_pickActive) {
+        if (_pickQueue.front().socket == &socket) {
+            /*
+             * The user is currently picking an emoji for this client:
+             * keep its place so that sendToClient() drops the reply
+             * instead of sending it to the next client.
+             */
+            _pickQueue.front().socket = nullptr;
+        }
+
+        ++it;
+    }
+
+    _pickQueue.erase(std::remove_if(it, _pickQueue.end(), [&socket](const _Pick& pick) {
+        return pick.socket == &socket;
+    }), _pickQueue.end());
+}
+
+void QJomeServer::_socketReadyRead(QLocalSocket& socket)
+{
+    // decode the received data into complete commands
+    std::vector<proto::Frame> cmds;
+    bool invalid = false;
+
+    {
+        auto& client = _clients.at(&socket);
+        const auto data = socket.readAll();
+
+        if (client.protoVersion == _ProtoVersion::V2) {
+            client.frameDecoder.append(data.constData(), data.size());
+        } else {
+            client.tmpData += data;
+        }
+
+        if (client.protoVersion == _ProtoVersion::Unknown) {
+            if (client.tmpData.isEmpty()) {
+                return;
+            }
+
+            if (client.tmpData.front() == proto::handshakeMagic[0]) {
+                if (!this->_decodeHandshake(socket, client)) {
+                    return;
+                }
+            } else {
+                client.protoVersion = _ProtoVersion::V1;
+            }
+        }
+
+        if (client.protoVersion == _ProtoVersion::V1) {
+            while (true) {
+                const auto nullPos = client.tmpData.indexOf('\0');
+
+                if (nullPos < 0) {
+                    break;
+                }
+
+                cmds.push_back(_frameFromV1Cmd(client.tmpData.left(nullPos)));
+                client.tmpData.remove(0, nullPos + 1);
+            }
+        } else {
+            assert(client.protoVersion == _ProtoVersion::V2);
+
+            while (auto frame = client.frameDecoder.next()) {
+                if (frame->type == proto::FrameType::Request) {
+                    cmds.push_back(std::move(*frame));
+                }
+            }
+
+            invalid = client.frameDecoder.error();
+        }
+    }
+
+    for (const auto& frame : cmds) {
+        // the client may disconnect while handling a previous command
+        const auto it = _clients.find(&socket);
+
+        if (it == _clients.end()) {
+            return;
+        }
+
+        this->_handleCmd(socket, it->second, frame);
     }
 
-    _socket = socket;
-    QObject::connect(socket, &QLocalSocket::disconnected, this, &QJomeServer::_socketDisconnected);
-    QObject::connect(socket, &QLocalSocket::readyRead, this, &QJomeServer::_socketReadyRead);
-    _tmpData.clear();
+    if (invalid) {
+        // can't recover from invalid framing
+        socket.abort();
+    }
 }
 
-void QJomeServer::_socketDisconnected()
+bool QJomeServer::_decodeHandshake(QLocalSocket& socket, _Client& client)
 {
-    _socket = nullptr;
+    if (static_cast<std::size_t>(client.tmpData.size()) < proto::handshakeSize) {
+        // incomplete
+        return false;
+    }
+
+    const auto version = proto::decodeHandshake(client.tmpData.constData());
+
+    if (!version || *version < 2) {
+        socket.abort();
+        return false;
+    }
+
+    // select the highest common version and confirm it
+    const auto handshake = proto::encodeHandshake(std::min(*version, proto::version));
+
+    socket.write(handshake.data(), handshake.size());
+    socket.flush();
+
+    // frames follow the handshake
+    client.protoVersion = _ProtoVersion::V2;
+    client.frameDecoder.append(client.tmpData.constData() + proto::handshakeSize,
+                               client.tmpData.size() - proto::handshakeSize);
+    client.tmpData.clear();
+    return true;
 }
 
-void QJomeServer::_socketReadyRead()
+proto::Frame QJomeServer::_frameFromV1Cmd(const QByteArray& cmdData)
 {
-    assert(_socket);
+    proto::Frame frame;
+    const auto parts = QString::fromUtf8(cmdData).split(' ', Qt::SkipEmptyParts);
+
+    if (parts.isEmpty()) {
+        return frame;
+    }
 
-    // receive one byte at a time until the null terminator
-    while (_socket->bytesAvailable() > 0) {
-        char byte;
+    frame.fields["cmd"] = parts.first().toStdString();
 
-        {
-            [[maybe_unused]] const auto count = _socket->read(&byte, 1);
+    for (auto i = 1; i < parts.size(); ++i) {
+        const auto eqPos = parts[i].indexOf('=');
 
-            assert(count == 1);
+        if (eqPos < 0) {
+            continue;
         }
 
-        if (byte == '\0') {
-            if (_tmpData == "pick") {
-                emit clientRequested(Command::Pick);
-            } else if (_tmpData == "quit") {
-                emit clientRequested(Command::Quit);
+        const auto key = parts[i].left(eqPos).toStdString();
+        const auto val = parts[i].mid(eqPos + 1);
+
+        /*
+         * v1 values aren't typed: only the values of integer fields
+         * become unsigned integers (`query=2024` and `cp-prefix=0` are
+         * strings).
+         */
+        if (key == "width" || key == "limit" || key == "no-vs16" || key == "no-newline") {
+            bool ok;
+            const auto uintVal = val.toULongLong(&ok);
+
+            if (ok) {
+                frame.fields[key] = static_cast<std::uint64_t>(uintVal);
+                continue;
             }
+        }
+
+        frame.fields[key] = val.toStdString();
+    }
+
+    return frame;
+}
+
+void QJomeServer::_handleCmd(QLocalSocket& socket, _Client& client, const proto::Frame& frame)
+{
+    const auto cmdName = frame.strField("cmd");
+    Request req;
+
+    req.recvTime = std::chrono::steady_clock::now();
+
+    if (cmdName && *cmdName == "pick") {
+        req.cmd = Command::Pick;
+    } else if (cmdName && *cmdName == "find") {
+        req.cmd = Command::Find;
+    } else if (cmdName && *cmdName == "stats") {
+        req.cmd = Command::Stats;
+    } else if (cmdName && *cmdName == "subscribe") {
+        req.cmd = Command::Subscribe;
+    } else if (cmdName && *cmdName == "reload") {
+        req.cmd = Command::Reload;
+    } else if (cmdName && *cmdName == "quit") {
+        req.cmd = Command::Quit;
+    } else {
+        if (client.protoVersion == _ProtoVersion::V2) {
+            _sendReply(socket, client.protoVersion, frame.reqId, proto::ReplyStatus::Error,
+                       cmdName ? "unknown command `" + *cmdName + "`" : "missing command");
+        }
+
+        // v1: ignore
+        return;
+    }
+
+    if (const auto width = frame.uintField("width")) {
+        req.emojiWidth = *width;
+    }
+
+    if (const auto query = frame.strField("query")) {
+        req.query = QString::fromStdString(*query);
+    }
+
+    if (const auto limit = frame.uintField("limit")) {
+        req.limit = *limit;
+    }
+
+    if (const auto fmtName = frame.strField("fmt")) {
+        req.fmt = formatFromName(QString::fromStdString(*fmtName));
+
+        if (!req.fmt) {
+            _sendReply(socket, client.protoVersion, frame.reqId, proto::ReplyStatus::Error,
+                       "unknown output format `" + *fmtName + "`");
+            return;
+        }
+    }
+
+    if (const auto skinToneName = frame.strField("skin-tone")) {
+        req.skinTone = skinToneFromName(QString::fromStdString(*skinToneName));
+
+        if (!req.skinTone) {
+            _sendReply(socket, client.protoVersion, frame.reqId, proto::ReplyStatus::Error,
+                       "unknown skin tone `" + *skinToneName + "`");
+            return;
+        }
+    }
+
+    if (const auto cpPrefix = frame.strField("cp-prefix")) {
+        req.cpPrefix = QString::fromStdString(*cpPrefix);
+    }
+
+    if (const auto removeVs16 = frame.uintField("no-vs16")) {
+        req.removeVs16 = *removeVs16 != 0;
+    }
+
+    if (const auto noNewline = frame.uintField("no-newline")) {
+        req.noNewline = *noNewline != 0;
+    }
+
+    switch (req.cmd) {
+    case Command::Pick:
+        _stats->increment(Stats::Counter::PickRequests);
+        this->_queuePick(socket, frame.reqId, req);
+        break;
+
+    case Command::Find:
+        _stats->increment(Stats::Counter::FindRequests);
+        this->_find(socket, client, frame.reqId, req);
+        break;
+
+    case Command::Stats:
+        this->_sendStats(socket, client, frame.reqId);
+        break;
+
+    case Command::Subscribe:
+        this->_subscribe(socket, client, frame.reqId);
+        break;
+
+    case Command::Reload:
+        this->_reload(socket, client, frame.reqId, req);
+        break;
+
+    case Command::Quit:
+        this->_quit(socket, client, frame.reqId, req);
+        break;
+    }
+}
+
+void QJomeServer::_find(QLocalSocket& socket, _Client& client, const std::uint32_t reqId,
+                        const Request& req)
+{
+    if (!_findHandler) {
+        _sendReply(socket, client.protoVersion, reqId, proto::ReplyStatus::Error,
+                   "`find` isn't supported");
+        return;
+    }
+
+    // reply right away, whatever the pending `pick` requests
+    _sendReply(socket, client.protoVersion, reqId, proto::ReplyStatus::Ok,
+               _findHandler(req).toStdString());
+}
 
-            _tmpData.clear();
+void QJomeServer::_sendStats(QLocalSocket& socket, _Client& client, const std::uint32_t reqId)
+{
+    _sendReply(socket, client.protoVersion, reqId, proto::ReplyStatus::Ok, _stats->toJson());
+}
+
+void QJomeServer::_subscribe(QLocalSocket& socket, _Client& client, const std::uint32_t reqId)
+{
+    if (client.protoVersion != _ProtoVersion::V2) {
+        // v1 has no way to tell events from replies
+        _sendReply(socket, client.protoVersion, reqId, proto::ReplyStatus::Error);
+        return;
+    }
+
+    client.subscribeReqId = reqId;
+    client.droppedEventCount = 0;
+    _sendReply(socket, client.protoVersion, reqId, proto::ReplyStatus::Ok);
+}
+
+bool QJomeServer::_samePickOptions(const Request& a, const Request& b)
+{
+    return a.emojiWidth == b.emojiWidth && a.fmt == b.fmt && a.skinTone == b.skinTone &&
+           a.cpPrefix == b.cpPrefix && a.removeVs16 == b.removeVs16 &&
+           a.noNewline == b.noNewline;
+}
+
+void QJomeServer::_queuePick(QLocalSocket& socket, const std::uint32_t reqId, const Request& req)
+{
+    /*
+     * Coalesce with the last pending request of the same client, if
+     * any, only if the same reply fits both.
+     */
+    const auto it = std::find_if(_pickQueue.rbegin(), _pickQueue.rend(),
+                                 [&socket](const _Pick& pick) {
+        return pick.socket == &socket;
+    });
+
+    if (it != _pickQueue.rend() && _samePickOptions(it->req, req)) {
+        it->reqIds.push_back(reqId);
+        return;
+    }
+
+    _pickQueue.push_back({&socket, {reqId}, req});
+
+    if (!_pickActive) {
+        this->_startNextPick();
+    }
+}
+
+void QJomeServer::_startNextPick()
+{
+    if (_pickActive || _pickQueue.empty()) {
+        return;
+    }
+
+    _pickActive = true;
+    emit this->clientRequested(_pickQueue.front().req);
+}
+
+void QJomeServer::_reload(QLocalSocket& socket, _Client& client, const std::uint32_t reqId,
+                          const Request& req)
+{
+    // reply right away: the new database is built in the background
+    _sendReply(socket, client.protoVersion, reqId, proto::ReplyStatus::Ok);
+    emit this->clientRequested(req);
+}
+
+void QJomeServer::_quit(QLocalSocket& socket, _Client& client, const std::uint32_t reqId,
+                        const Request& req)
+{
+    const auto protoVersion = client.protoVersion;
+
+    // cancel all the pending `pick` requests
+    const auto picks = std::move(_pickQueue);
+
+    _pickQueue.clear();
+    _pickActive = false;
+
+    for (const auto& pick : picks) {
+        if (!pick.socket) {
+            continue;
+        }
+
+        const auto it = _clients.find(pick.socket);
+
+        if (it == _clients.end()) {
             continue;
         }
 
-        _tmpData += byte;
+        for (const auto pickReqId : pick.reqIds) {
+            _sendReply(*pick.socket, it->second.protoVersion, pickReqId,
+                       proto::ReplyStatus::Cancelled);
+        }
+    }
+
+    // reply to the quitting client
+    if (_clients.find(&socket) != _clients.end()) {
+        _sendReply(socket, protoVersion, reqId, proto::ReplyStatus::Ok);
     }
+
+    emit this->clientRequested(req);
 }
 
-void QJomeServer::sendToClient(const QString& str)
+void QJomeServer::_sendReply(QLocalSocket& socket, const _ProtoVersion protoVersion,
+                             const std::uint32_t reqId, const proto::ReplyStatus status,
+                             const std::string& str)
 {
-    if (!_socket || _socket->state() != QLocalSocket::ConnectedState) {
+    if (socket.state() != QLocalSocket::ConnectedState) {
         // not connected for some reason
         return;
     }
 
-    const auto utf8Data = str.toUtf8();
+    if (protoVersion == _ProtoVersion::V2) {
+        proto::Frame frame;
+
+        frame.reqId = reqId;
+        frame.type = proto::FrameType::Reply;
+        frame.fields["status"] = static_cast<std::uint64_t>(status);
+
+        if (status == proto::ReplyStatus::Ok) {
+            frame.fields["output"] = str;
+        } else if (status == proto::ReplyStatus::Error) {
+            frame.fields["error"] = str;
+        }
+
+        const auto data = proto::encodeFrame(frame);
+
+        socket.write(data.data(), data.size());
+    } else {
+        // v1: null-terminated output, empty if not successful
+        if (status == proto::ReplyStatus::Ok) {
+            socket.write(str.data(), str.size());
+        }
+
+        socket.write(QByteArray {1, '\0'}, 1);
+    }
+
+    socket.flush();
+}
+
+void QJomeServer::sendToClient(const QString& str)
+{
+    const auto acceptTime = std::chrono::steady_clock::now();
+
+    // continue on the thread of this server
+    QMetaObject::invokeMethod(this, [this, str, acceptTime] {
+        this->_sendToClient(str, acceptTime);
+    });
+}
+
+void QJomeServer::_sendToClient(const QString& str,
+                                const std::chrono::steady_clock::time_point acceptTime)
+{
+    if (!_pickActive) {
+        // no current `pick` request
+        return;
+    }
+
+    const auto pick = std::move(_pickQueue.front());
+
+    _pickQueue.pop_front();
+    _pickActive = false;
+
+    if (pick.socket) {
+        const auto it = _clients.find(pick.socket);
+
+        if (it != _clients.end()) {
+            const auto utf8Str = str.toStdString();
+            const auto status = str.isEmpty() ? proto::ReplyStatus::Cancelled :
+                                proto::ReplyStatus::Ok;
+
+            for (const auto reqId : pick.reqIds) {
+                _sendReply(*pick.socket, it->second.protoVersion, reqId, status, utf8Str);
+            }
+
+            if (status == proto::ReplyStatus::Ok) {
+                _stats->record(Stats::Latency::AcceptToReply,
+                               std::chrono::steady_clock::now() - acceptTime);
+            }
+        }
+    }
+
+    if (!_pickQueue.empty()) {
+        /*
+         * Handle the next request once the caller is done with the
+         * current one (it's possibly about to hide the window).
+         */
+        QTimer::singleShot(0, this, &QJomeServer::_startNextPick);
+    }
+}
+
+void QJomeServer::publishEvent(const Event event, const QString& emoji,
+                               const QString& emojiName)
+{
+    // continue on the thread of this server
+    QMetaObject::invokeMethod(this, [this, event, emoji, emojiName] {
+        this->_publishEvent(event, emoji, emojiName);
+    });
+}
+
+void QJomeServer::_publishEvent(const Event event, const QString& emoji,
+                                const QString& emojiName)
+{
+    proto::Frame frame;
+
+    frame.type = proto::FrameType::Event;
+
+    switch (event) {
+    case Event::Accept:
+        frame.fields["event"] = std::string {"accept"};
+        frame.fields["emoji"] = emoji.toStdString();
+        frame.fields["name"] = emojiName.toStdString();
+        break;
+
+    case Event::Cancel:
+        frame.fields["event"] = std::string {"cancel"};
+        break;
+
+    case Event::RecentChanged:
+        frame.fields["event"] = std::string {"recent-changed"};
+        break;
+    }
+
+    for (auto& [socket, client] : _clients) {
+        if (!client.subscribeReqId || socket->state() != QLocalSocket::ConnectedState) {
+            continue;
+        }
+
+        if (socket->bytesToWrite() > _maxSubscriberPendingSize) {
+            // slow subscriber: drop instead of buffering without limit
+            ++client.droppedEventCount;
+            continue;
+        }
+
+        frame.reqId = *client.subscribeReqId;
+
+        if (client.droppedEventCount > 0) {
+            frame.fields["dropped"] = client.droppedEventCount;
+            client.droppedEventCount = 0;
+        } else {
+            frame.fields.erase("dropped");
+        }
+
+        const auto data = proto::encodeFrame(frame);
 
-    _socket->write(utf8Data.constData(), utf8Data.size());
-    _socket->write(QByteArray {1, '\0'}, 1);
+        socket->write(data.data(), data.size());
+        socket->flush();
+    }
 }
 
 } // namespace jome
@@ -11,12 +11,84 @@
 #include <QObject>
 #include <QLocalServer>
 #include <QLocalSocket>
+#include <QByteArray>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <deque>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <functional>
+
+#include "proto.hpp"
+#include "emoji-db.hpp"
+#include "format.hpp"
+#include "stats.hpp"
 
 namespace jome {
 
 /*
  * A server which listens to `jome-ctl` connections, receives commands,
  * and replies accordingly.
+ *
+ * The server accepts any number of concurrent connections.
+ *
+ * It queues `pick` requests (FIFO) as only one emoji may be picked at a
+ * time: it emits clientRequested() for the next queued `pick` request
+ * once the user picked an emoji (or cancelled) for the current one. A
+ * connection which sends another `pick` command with the same options
+ * while its previous one is still pending (queued or current) doesn't
+ * queue a new request: the single reply goes to both. A `pick` command
+ * with other options gets its own queued request.
+ *
+ * The server handles a `find` request immediately, without showing
+ * anything, with its find handler (see findHandler()).
+ *
+ * The server handles a `stats` request immediately: it replies with
+ * its runtime statistics as a JSON document (see `Stats`).
+ *
+ * The server handles a `subscribe` request (v2 only) immediately: it
+ * replies, keeps the connection open, and then sends an event frame
+ * (see `proto::FrameType::Event`) with the ID of the request for each
+ * published event (see publishEvent()). An event frame contains an
+ * `event` string field (`accept`, `cancel`, or `recent-changed`) and,
+ * for `accept`, the `emoji` and `name` string fields. The server
+ * doesn't wait for slow subscribers: when too much data is pending for
+ * a subscriber, the server drops the event and the next sent event
+ * frame contains a `dropped` unsigned integer field (number of dropped
+ * events).
+ *
+ * The server handles a `reload` request immediately: it replies, and
+ * then emits clientRequested() to reload the emoji database in
+ * the background.
+ *
+ * The server handles a `quit` request immediately: it cancels all the
+ * pending `pick` requests, replies to the quitting client, and then
+ * emits clientRequested().
+ *
+ * The server speaks two protocols, selected per connection from the
+ * first received byte:
+ *
+ * v1:
+ *     A command is a null-terminated UTF-8 string: the command name
+ *     followed with zero or more space-separated `KEY=VALUE` options.
+ *     A reply is a null-terminated UTF-8 string, empty when cancelled.
+ *
+ * v2:
+ *     Handshake and length-prefixed frames (see `proto.hpp`). A request
+ *     frame contains a `cmd` string field and option fields. A reply
+ *     frame has the ID of its request and contains a `status` field
+ *     (see `proto::ReplyStatus`) as well as an `output` or `error`
+ *     string field.
+ *
+ * In both cases, the server ignores unknown options.
+ *
+ * A jome server is meant to live on its own thread (see
+ * QObject::moveToThread()) so that accepting connections and replying
+ * don't depend on the load of the GUI thread: connect to
+ * clientRequested() with a context object of the GUI thread to receive
+ * requests there.
  */
 class QJomeServer final :
     public QObject
@@ -32,39 +104,255 @@ public:
         // pick and emoji (show the window)
         Pick,
 
+        // find emojis (no window)
+        Find,
+
+        // get runtime statistics
+        Stats,
+
+        // receive events
+        Subscribe,
+
+        // reload the emoji database
+        Reload,
+
         // terminate the server
         Quit,
     };
 
+    /*
+     * Client request.
+     */
+    struct Request final
+    {
+        // requested command
+        Command cmd;
+
+        // emoji width (pixels) to pick an emoji (`width` option)
+        std::optional<unsigned int> emojiWidth;
+
+        // find query, `TERMS` or `CAT/TERMS` (`query` option)
+        QString query;
+
+        // maximum number of find results (`limit` option)
+        std::optional<unsigned int> limit;
+
+        // output format (`fmt` option: `utf-8` or `cp`)
+        std::optional<Format> fmt;
+
+        // default skin tone (`skin-tone` option: `L`, `ML`, `M`, `MD`, or `D`)
+        std::optional<Emoji::SkinTone> skinTone;
+
+        // codepoint prefix (`cp-prefix` option)
+        std::optional<QString> cpPrefix;
+
+        // whether or not to remove VS-16 codepoints (`no-vs16` option)
+        std::optional<bool> removeVs16;
+
+        // whether or not to omit the trailing newline (`no-newline` option)
+        std::optional<bool> noNewline;
+
+        // reception time
+        std::chrono::steady_clock::time_point recvTime;
+    };
+
+    /*
+     * Published event.
+     */
+    enum class Event
+    {
+        // the user accepted an emoji
+        Accept,
+
+        // the user cancelled
+        Cancel,
+
+        // the list of recent emojis changed
+        RecentChanged,
+    };
+
+    /*
+     * Find handler: returns the reply to a `find` request.
+     *
+     * The server calls it from its own thread.
+     */
+    using FindHandler = std::function<QString (const Request&)>;
+
 public:
     /*
-     * Builds a jome server using the socket named `name`.
+     * Builds a jome server which is going to use the socket
+     * named `name` and to count requests into `stats`.
+     *
+     * Call listen() to start listening.
      */
-    explicit QJomeServer(QObject *parent, const QString& name);
+    explicit QJomeServer(QObject *parent, const QString& name, Stats& stats);
 
     /*
-     * Sends the message `str` (null-terminated UTF-8 data) to the
-     * connected client.
+     * Starts listening, returning true on success.
+     *
+     * Call this method from the thread of this server.
+     */
+    bool listen();
+
+    /*
+     * Description of the last error (after listen() fails).
+     */
+    QString errorString() const
+    {
+        return _server.errorString();
+    }
+
+    /*
+     * Sends the message `str` (UTF-8) to the client of the current
+     * `pick` request, and then handles the next queued `pick` request,
+     * if any.
+     *
+     * An empty `str` means the user cancelled.
+     *
+     * Drops the message if the client disconnected in the meantime.
+     *
+     * You may call this method from any thread.
      */
     void sendToClient(const QString& str);
 
+    /*
+     * Sends the event `event` to all the subscribers.
+     *
+     * `emoji` and `emojiName` are the accepted emoji (UTF-8) and its
+     * name for `Event::Accept`.
+     *
+     * This method doesn't wait for the subscribers: you may call it
+     * from any thread.
+     */
+    void publishEvent(Event event, const QString& emoji = {}, const QString& emojiName = {});
+
+    /*
+     * Sets the handler of `find` requests to `handler`.
+     *
+     * Without a find handler, the server replies to `find` requests
+     * with an error.
+     *
+     * Call this method before moving this server to another thread.
+     */
+    void findHandler(FindHandler handler)
+    {
+        _findHandler = std::move(handler);
+    }
+
 signals:
     /*
-     * A connected client requested the command `cmd`.
+     * A connected client sent the request `req`.
+     */
+    void clientRequested(const Request& req);
+
+private:
+    /*
+     * Protocol version of a connection.
+     */
+    enum class _ProtoVersion
+    {
+        // nothing received yet
+        Unknown,
+
+        V1,
+        V2,
+    };
+
+    /*
+     * State of a connected client.
+     */
+    struct _Client final
+    {
+        // protocol version
+        _ProtoVersion protoVersion = _ProtoVersion::Unknown;
+
+        // received data not decoded yet (v1 command or v2 handshake)
+        QByteArray tmpData;
+
+        // v2 frame decoder
+        proto::FrameDecoder frameDecoder;
+
+        // ID of the `subscribe` request, if subscribed
+        std::optional<std::uint32_t> subscribeReqId;
+
+        // number of events dropped since the last sent one
+        std::uint64_t droppedEventCount = 0;
+    };
+
+    /*
+     * Queued `pick` request.
      */
-    void clientRequested(Command cmd);
+    struct _Pick final
+    {
+        // client (`nullptr` if it disconnected while being served)
+        QLocalSocket *socket;
+
+        // IDs of the coalesced requests to reply to (always 0 with v1)
+        std::vector<std::uint32_t> reqIds;
+
+        // first request
+        Request req;
+    };
 
 private slots:
     void _newConnection();
-    void _socketDisconnected();
-    void _socketReadyRead();
+    void _startNextPick();
+    void _sendToClient(const QString& str, std::chrono::steady_clock::time_point acceptTime);
+    void _publishEvent(Event event, const QString& emoji, const QString& emojiName);
+
+private:
+    void _socketDisconnected(QLocalSocket& socket);
+    void _socketReadyRead(QLocalSocket& socket);
+    bool _decodeHandshake(QLocalSocket& socket, _Client& client);
+    void _handleCmd(QLocalSocket& socket, _Client& client, const proto::Frame& frame);
+    void _queuePick(QLocalSocket& socket, std::uint32_t reqId, const Request& req);
+    void _find(QLocalSocket& socket, _Client& client, std::uint32_t reqId, const Request& req);
+    void _reload(QLocalSocket& socket, _Client& client, std::uint32_t reqId, const Request& req);
+    void _quit(QLocalSocket& socket, _Client& client, std::uint32_t reqId, const Request& req);
+    void _sendStats(QLocalSocket& socket, _Client& client, std::uint32_t reqId);
+    void _subscribe(QLocalSocket& socket, _Client& client, std::uint32_t reqId);
+    static proto::Frame _frameFromV1Cmd(const QByteArray& cmdData);
+    static bool _samePickOptions(const Request& a, const Request& b);
+    static void _sendReply(QLocalSocket& socket, _ProtoVersion protoVersion,
+                           std::uint32_t reqId, proto::ReplyStatus status,
+                           const std::string& str = {});
 
 private:
-    QLocalServer _server;
-    QLocalSocket *_socket = nullptr;
-    QString _tmpData;
+    /*
+     * Maximum number of bytes waiting to be written to a subscriber
+     * before the server drops its events.
+     */
+    static constexpr qint64 _maxSubscriberPendingSize = 64 * 1024;
+
+private:
+    const QString _name;
+
+    // runtime statistics
+    Stats * const _stats;
+
+    // child so that it follows this server to its thread
+    QLocalServer _server {this};
+
+    // connected clients
+    std::unordered_map<QLocalSocket *, _Client> _clients;
+
+    /*
+     * Pending `pick` requests, in order.
+     *
+     * When `_pickActive` is true, the first element is the current
+     * `pick` request.
+     */
+    std::deque<_Pick> _pickQueue;
+
+    // whether or not the first request of `_pickQueue` is being served
+    bool _pickActive = false;
+
+    // `find` request handler
+    FindHandler _findHandler;
 };
 
 } // namespace jome
 
+Q_DECLARE_METATYPE(jome::QJomeServer::Request)
+
 #endif // _JOME_Q_JOME_SERVER_HPP
@@ -17,6 +17,8 @@
 #include <QGraphicsTextItem>
 #include <QKeyEvent>
 #include <QPalette>
+#include <QSignalBlocker>
+#include <chrono>
 #include <functional>
 
 #include "q-jome-window.hpp"
@@ -117,6 +119,25 @@ bool QFindBoxEventFilter::eventFilter(QObject * const obj, QEvent * const event)
 
         break;
 
+    case Qt::Key_Plus:
+    case Qt::Key_Equal:
+        if (withCtrl) {
+            emit this->zoomInKeyPressed();
+        } else {
+            return QObject::eventFilter(obj, event);
+        }
+
+        break;
+
+    case Qt::Key_Minus:
+        if (withCtrl) {
+            emit this->zoomOutKeyPressed();
+        } else {
+            return QObject::eventFilter(obj, event);
+        }
+
+        break;
+
     default:
         return QObject::eventFilter(obj, event);
     }
@@ -124,16 +145,20 @@ bool QFindBoxEventFilter::eventFilter(QObject * const obj, QEvent * const event)
     return true;
 }
 
-QJomeWindow::QJomeWindow(const EmojiDb& emojiDb, const bool darkBg, const bool noCatList,
-                         const bool noCatLabels, const bool noKwList,
+QJomeWindow::QJomeWindow(const EmojiDb& emojiDb, Stats& stats,
+                         const EmojiDb::EmojiSize emojiSize, const bool darkBg,
+                         const bool noCatList, const bool noCatLabels, const bool noKwList,
+                         const bool tileCache, const bool progressiveBuild,
                          const std::optional<unsigned int> selectedEmojiFlashPeriod) :
-    _emojiDb {&emojiDb}
+    _emojiDb {&emojiDb},
+    _stats {&stats}
 {
     this->setWindowIcon(QIcon {qFmtFormat("{}/icon.png", JOME_DATA_DIR)});
     this->setWindowTitle("jome");
     this->resize(800, 600);
     this->_setMainStyleSheet();
-    this->_buildUi(darkBg, noCatList, noCatLabels, noKwList, selectedEmojiFlashPeriod);
+    this->_buildUi(emojiSize, darkBg, noCatList, noCatLabels, noKwList, tileCache, progressiveBuild,
+                   selectedEmojiFlashPeriod);
 }
 
 void QJomeWindow::_setMainStyleSheet()
@@ -211,8 +236,9 @@ void setQLabelFgColor(QLabel& widget, const QColor& color)
 
 } // namespace
 
-void QJomeWindow::_buildUi(const bool darkBg, const bool noCatList, const bool noCatLabels,
-                           const bool noKwList,
+void QJomeWindow::_buildUi(const EmojiDb::EmojiSize emojiSize, const bool darkBg,
+                           const bool noCatList, const bool noCatLabels, const bool noKwList,
+                           const bool tileCache, const bool progressiveBuild,
                            const std::optional<unsigned int> selectedEmojiFlashPeriod)
 {
     _wFindBox = new QLineEdit;
@@ -264,6 +290,10 @@ void QJomeWindow::_buildUi(const bool darkBg, const bool noCatList, const bool n
                      &QJomeWindow::_searchBoxEndKeyPressed);
     QObject::connect(eventFilter, &QFindBoxEventFilter::escapeKeyPressed, this,
                      &QJomeWindow::_searchBoxEscapeKeyPressed);
+    QObject::connect(eventFilter, &QFindBoxEventFilter::zoomInKeyPressed, this,
+                     &QJomeWindow::_searchBoxZoomInKeyPressed);
+    QObject::connect(eventFilter, &QFindBoxEventFilter::zoomOutKeyPressed, this,
+                     &QJomeWindow::_searchBoxZoomOutKeyPressed);
 
     auto mainVbox = new QVBoxLayout;
 
@@ -271,7 +301,8 @@ void QJomeWindow::_buildUi(const bool darkBg, const bool noCatList, const bool n
     mainVbox->setSpacing(8);
     mainVbox->addWidget(_wFindBox);
     _wEmojiGrid = new QEmojiGridWidget {
-        nullptr, *_emojiDb, darkBg, noCatLabels, selectedEmojiFlashPeriod
+        nullptr, *_emojiDb, *_stats, emojiSize, darkBg, noCatLabels, tileCache,
+        progressiveBuild, selectedEmojiFlashPeriod
     };
     QObject::connect(_wEmojiGrid, &QEmojiGridWidget::selectionChanged, this,
                      &QJomeWindow::_emojiSelectionChanged);
@@ -280,6 +311,8 @@ void QJomeWindow::_buildUi(const bool darkBg, const bool noCatList, const bool n
                      &QJomeWindow::_emojiHoverEntered);
     QObject::connect(_wEmojiGrid, &QEmojiGridWidget::emojiHoverLeaved, this,
                      &QJomeWindow::_emojiHoverLeaved);
+    QObject::connect(_wEmojiGrid, &QEmojiGridWidget::currentCatChanged, this,
+                     &QJomeWindow::_emojiGridCurrentCatChanged);
     _wCatList = this->_createCatListWidget();
     this->_wCatList->setCurrentRow(0);
 
@@ -352,6 +385,7 @@ void QJomeWindow::showEvent(QShowEvent * const event)
     _wEmojiGrid->showAllEmojis();
     _wFindBox->clear();
     _wFindBox->setFocus();
+    emit this->shown();
 }
 
 void QJomeWindow::closeEvent(QCloseEvent * const event)
@@ -365,31 +399,31 @@ void QJomeWindow::hideEvent(QHideEvent * const event)
 {
     saveWindowGeometry(*this);
     QMainWindow::hideEvent(event);
+    emit this->hidden();
 }
 
-void QJomeWindow::_findEmojis(const QString& cat, const QString& needles)
+void QJomeWindow::_findEmojis(const QString& query)
 {
     std::vector<const Emoji *> results;
 
-    _emojiDb->findEmojis(cat, needles, results);
+    _emojiDb->findEmojis(query, results);
     _wEmojiGrid->showFindResults(results);
 }
 
 void QJomeWindow::_searchTextChanged(const QString& text)
 {
-    if (text.isEmpty()) {
-        _wEmojiGrid->showAllEmojis();
-        return;
-    }
+    const auto startTime = std::chrono::steady_clock::now();
 
-    const auto parts = text.split("/");
+    _stats->increment(Stats::Counter::FindBoxQueries);
 
-    if (parts.size() != 2) {
-        this->_findEmojis("", text);
-        return;
+    if (text.isEmpty()) {
+        _wEmojiGrid->showAllEmojis();
+    } else {
+        this->_findEmojis(text);
     }
 
-    this->_findEmojis(parts[0], parts[1]);
+    _stats->record(Stats::Latency::KeystrokeToResults,
+                   std::chrono::steady_clock::now() - startTime);
 }
 
 void QJomeWindow::_catListItemSelectionChanged()
@@ -414,6 +448,21 @@ void QJomeWindow::_catListItemClicked(QListWidgetItem * const)
     this->_catListItemSelectionChanged();
 }
 
+void QJomeWindow::_emojiGridCurrentCatChanged(const EmojiCat& cat)
+{
+    for (auto row = 0; row < _wCatList->count(); ++row) {
+        const auto& item = static_cast<const QCatListWidgetItem&>(*_wCatList->item(row));
+
+        if (&item.cat() == &cat) {
+            // highlight without scrolling the emoji grid back
+            const QSignalBlocker blocker {_wCatList};
+
+            _wCatList->setCurrentRow(row);
+            break;
+        }
+    }
+}
+
 void QJomeWindow::_searchBoxUpKeyPressed()
 {
     _wEmojiGrid->selectPreviousRow();
@@ -460,6 +509,16 @@ void QJomeWindow::_searchBoxEscapeKeyPressed()
     emit this->cancelled();
 }
 
+void QJomeWindow::_searchBoxZoomInKeyPressed()
+{
+    _wEmojiGrid->zoomIn();
+}
+
+void QJomeWindow::_searchBoxZoomOutKeyPressed()
+{
+    _wEmojiGrid->zoomOut();
+}
+
 void QJomeWindow::_searchBoxEnterKeyPressed(const bool withShift)
 {
     this->_acceptSelectedEmoji(std::nullopt, withShift);
@@ -532,7 +591,7 @@ void QJomeWindow::_acceptEmoji(const Emoji& emoji,
         return;
     }
 
-    emit this->emojiChosen(emoji, skinTone, removeVs16);
+    emit this->emojiChosen(emoji, skinTone, removeVs16, _wFindBox->text());
 }
 
 void QJomeWindow::_requestSelectedEmojiInfo()
@@ -748,7 +807,7 @@ void QJomeWindow::_updateKwLabel(const Emoji * const emoji)
     if (emoji) {
         QStringList kws;
 
-        for (auto& kw : emoji->keywords()) {
+        for (auto& kw : _emojiDb->keywords(*emoji)) {
             kws.append(kw.toHtmlEscaped());
         }
 
@@ -759,10 +818,77 @@ void QJomeWindow::_updateKwLabel(const Emoji * const emoji)
     _wKwLabel->setText(text);
 }
 
-void QJomeWindow::emojiDbChanged()
+void QJomeWindow::emojiDb(const EmojiDb& emojiDb)
 {
+    _emojiDb = &emojiDb;
+    _selectedEmoji = nullptr;
+    _wEmojiGrid->emojiDb(emojiDb);
+
+    // the categories may differ
+    {
+        const QSignalBlocker blocker {_wCatList};
+
+        _wCatList->clear();
+
+        for (const auto& cat : _emojiDb->cats()) {
+            _wCatList->addItem(new QCatListWidgetItem {*cat});
+        }
+
+        _wCatList->setCurrentRow(0);
+    }
+
+    if (!_emojisWidgetBuilt) {
+        // showEvent() builds it
+        return;
+    }
+
+    // now rather than when showing the window
     _wEmojiGrid->rebuild();
-    _wEmojiGrid->showAllEmojis();
+
+    if (_wFindBox->text().isEmpty()) {
+        _wEmojiGrid->showAllEmojis();
+    } else {
+        this->_findEmojis(_wFindBox->text());
+    }
+}
+
+void QJomeWindow::recentEmojisChanged()
+{
+    _wEmojiGrid->refreshRecentCat();
+}
+
+void QJomeWindow::userKeywordsChanged()
+{
+    if (!_emojisWidgetBuilt || _wFindBox->text().isEmpty()) {
+        // nothing found with keywords
+        return;
+    }
+
+    this->_findEmojis(_wFindBox->text());
+}
+
+void QJomeWindow::emojiSize(const EmojiDb::EmojiSize emojiSize)
+{
+    _wEmojiGrid->emojiSize(emojiSize);
+}
+
+EmojiDb::EmojiSize QJomeWindow::emojiSize() const noexcept
+{
+    return _wEmojiGrid->emojiSize();
+}
+
+void QJomeWindow::preloadEmojiImages()
+{
+    _wEmojiGrid->preloadEmojiImages();
+}
+
+void QJomeWindow::release()
+{
+    _selectedEmoji = nullptr;
+    _wEmojiGrid->release();
+
+    // showEvent() builds it again
+    _emojisWidgetBuilt = false;
 }
 
 } // namespace jome
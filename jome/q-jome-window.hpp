@@ -22,6 +22,7 @@
 
 #include "emoji-db.hpp"
 #include "q-emoji-grid-widget.hpp"
+#include "stats.hpp"
 
 namespace jome {
 
@@ -57,6 +58,8 @@ signals:
     void homeKeyPressed();
     void endKeyPressed();
     void escapeKeyPressed();
+    void zoomInKeyPressed();
+    void zoomOutKeyPressed();
 };
 
 /*
@@ -73,7 +76,7 @@ signals:
  * cancelled() signal:
  *     The emoji picking operation was cancelled.
  *
- * Call emojiDbChanged() whenever you update the linked emoji database.
+ * Call emojiDb() to link another emoji database.
  */
 class QJomeWindow final :
     public QMainWindow
@@ -82,7 +85,10 @@ class QJomeWindow final :
 
 public:
     /*
-     * Builds a jome window to display the emojis of `emojiDb` with:
+     * Builds a jome window to display the emojis of `emojiDb`,
+     * recording runtime statistics into `stats`, with:
+     *
+     * • An initial emoji size of `emojiSize`.
      *
      * • A dark background if `darkBg` is true.
      *
@@ -93,39 +99,96 @@ public:
      *
      * • No keyword list at the bottom if `noKwList` is true.
      *
+     * • Category panels rendered as cached pixmap tiles if `tileCache`
+     *   is true.
+     *
+     * • An emoji grid built progressively if `progressiveBuild`
+     *   is true.
+     *
      * • A selection square flashing period of
      *   `*selectedEmojiFlashPeriod` is set.
      */
-    explicit QJomeWindow(const EmojiDb& emojiDb, bool darkBg, bool noCatList, bool noCatLabels,
-                         bool noKwList,
+    explicit QJomeWindow(const EmojiDb& emojiDb, Stats& stats, EmojiDb::EmojiSize emojiSize,
+                         bool darkBg, bool noCatList, bool noCatLabels, bool noKwList,
+                         bool tileCache, bool progressiveBuild,
                          std::optional<unsigned int> selectedEmojiFlashPeriod);
 
+    /*
+     * Sets the current emoji size to `emojiSize`.
+     */
+    void emojiSize(EmojiDb::EmojiSize emojiSize);
+
+    /*
+     * Current emoji size.
+     */
+    EmojiDb::EmojiSize emojiSize() const noexcept;
+
+    /*
+     * Makes this window present the emojis of `emojiDb` from now on,
+     * rebuilding the emoji grid once if it's already built.
+     *
+     * The previous emoji database must exist until this
+     * method returns.
+     */
+    void emojiDb(const EmojiDb& emojiDb);
+
+    /*
+     * Loads the emoji images of the current emoji size now instead of
+     * when first showing the window.
+     */
+    void preloadEmojiImages();
+
+    /*
+     * Removes the emoji grid contents and unloads the emoji images to
+     * release memory while this window is hidden: showing it builds
+     * them again.
+     */
+    void release();
+
 signals:
     /*
      * Emoji `emoji` was chosen, possibly with the skin tone `skinTone`,
      * and with a forced removal of VS-16 codepoints if `removeVs16`
-     * is true.
+     * is true, while the find box contained `findQuery`.
      */
     void emojiChosen(const Emoji& emoji, std::optional<Emoji::SkinTone> skinTone,
-                     bool removeVs16);
+                     bool removeVs16, const QString& findQuery);
 
     /*
      * Emoji picking operation was cancelled.
      */
     void cancelled();
 
+    /*
+     * The window was shown.
+     */
+    void shown();
+
+    /*
+     * The window was hidden.
+     */
+    void hidden();
+
 public slots:
     /*
-     * The linked emoji database changed behind the scenes.
+     * Only the "Recent" category of the linked emoji database changed
+     * behind the scenes.
+     */
+    void recentEmojisChanged();
+
+    /*
+     * Only the user-defined keywords of the linked emoji database
+     * changed behind the scenes.
      */
-    void emojiDbChanged();
+    void userKeywordsChanged();
 
 private:
     void closeEvent(QCloseEvent *event) override;
     void showEvent(QShowEvent *event) override;
     void hideEvent(QHideEvent *event) override;
     void _setMainStyleSheet();
-    void _buildUi(bool darkBg, bool noCatList, bool noCatLabels, bool noKwList,
+    void _buildUi(EmojiDb::EmojiSize emojiSize, bool darkBg, bool noCatList, bool noCatLabels,
+                  bool noKwList, bool tileCache, bool progressiveBuild,
                   std::optional<unsigned int> selectedEmojiFlashPeriod);
     QListWidget *_createCatListWidget();
     void _updateBottomLabels(const Emoji *emoji);
@@ -133,7 +196,7 @@ private:
     void _updateSkinToneLabel(const Emoji *emoji);
     void _updateVersionLabel(const Emoji *emoji);
     void _updateKwLabel(const Emoji *emoji);
-    void _findEmojis(const QString& cat, const QString& needles);
+    void _findEmojis(const QString& query);
     void _acceptSelectedEmoji(std::optional<Emoji::SkinTone> skinTone, bool removeVs16);
     void _acceptEmoji(const Emoji& emoji, std::optional<Emoji::SkinTone> skinTone,
                       bool removeVs16);
@@ -160,13 +223,17 @@ private slots:
     void _searchBoxHomeKeyPressed();
     void _searchBoxEndKeyPressed();
     void _searchBoxEscapeKeyPressed();
+    void _searchBoxZoomInKeyPressed();
+    void _searchBoxZoomOutKeyPressed();
     void _emojiSelectionChanged(const Emoji *emoji);
     void _emojiClicked(const Emoji& emoji, bool withShift);
     void _emojiHoverEntered(const Emoji& emoji);
     void _emojiHoverLeaved(const Emoji& emoji);
+    void _emojiGridCurrentCatChanged(const EmojiCat& cat);
 
 private:
-    const EmojiDb * const _emojiDb;
+    const EmojiDb *_emojiDb;
+    Stats * const _stats;
     QEmojiGridWidget *_wEmojiGrid = nullptr;
     QListWidget *_wCatList = nullptr;
     QLabel *_wInfoLabel = nullptr;
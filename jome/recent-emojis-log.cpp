@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <unordered_set>
+#include <utility>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "recent-emojis-log.hpp"
+
+namespace jome {
+
+RecentEmojisLog::RecentEmojisLog(std::string path) :
+    _path {std::move(path)},
+    _lockPath {_path + ".lock"}
+{
+    // make sure there's a file to watch
+    if (const auto fd = open(_lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600); fd >= 0) {
+        close(fd);
+    }
+
+    // start last: the writer thread uses the other members
+    _writerThread = std::thread {&RecentEmojisLog::_writerThreadMain, this};
+}
+
+RecentEmojisLog::~RecentEmojisLog()
+{
+    {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        _stop = true;
+    }
+
+    _cv.notify_one();
+
+    // complete the queued operations before returning
+    _writerThread.join();
+}
+
+bool RecentEmojisLog::exists() const
+{
+    struct stat st;
+
+    return stat(_path.c_str(), &st) == 0;
+}
+
+int RecentEmojisLog::_lock(const int operation) const
+{
+    const auto fd = open(_lockPath.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+
+    if (fd < 0) {
+        // work without a lock
+        return -1;
+    }
+
+    while (flock(fd, operation) < 0 && errno == EINTR);
+
+    return fd;
+}
+
+RecentEmojisLog::Contents RecentEmojisLog::_loadUnlocked() const
+{
+    std::ifstream file {_path};
+    Contents contents {{}, UsageStore<std::string> {maxEmojiCount}, PickAffinity<std::string> {}};
+    std::vector<std::string> lines;
+    std::string line;
+
+    while (std::getline(file, line)) {
+        /*
+         * `EMOJI`, `EMOJI<TAB>TIME`, `EMOJI<TAB>TIME<TAB>COUNT`, or
+         * `EMOJI<TAB>TIME<TAB>COUNT<TAB>PREFIX`.
+         */
+        std::istringstream lineStream {line};
+        std::string emojiStr;
+        long long time = 0;
+        double count = 1.;
+        std::string prefix;
+
+        std::getline(lineStream, emojiStr, '\t');
+
+        if (emojiStr.empty()) {
+            continue;
+        }
+
+        // without a time (older jome): as old as it gets
+        if (lineStream >> time >> count && lineStream.get() == '\t') {
+            std::getline(lineStream, prefix);
+        }
+
+        const UsageStore<std::string>::Clock::time_point timePoint {std::chrono::seconds {time}};
+
+        if (!prefix.empty()) {
+            contents.affinity.add(prefix, emojiStr, count, timePoint);
+            continue;
+        }
+
+        contents.usage.add(emojiStr, count, timePoint);
+        lines.push_back(std::move(emojiStr));
+    }
+
+    // last occurrences, from the end
+    std::unordered_set<std::string> seen;
+
+    for (auto it = lines.rbegin(); it != lines.rend(); ++it) {
+        if (seen.insert(*it).second) {
+            contents.emojiStrs.push_back(std::move(*it));
+        }
+    }
+
+    return contents;
+}
+
+std::uint64_t RecentEmojisLog::_readGeneration(const int lockFd)
+{
+    std::uint64_t generation = 0;
+
+    if (pread(lockFd, &generation, sizeof generation, 0) != sizeof generation) {
+        // new lock file
+        return 0;
+    }
+
+    return generation;
+}
+
+void RecentEmojisLog::_bumpGeneration(const int lockFd)
+{
+    if (lockFd < 0) {
+        return;
+    }
+
+    const auto prevGeneration = _readGeneration(lockFd);
+    const auto generation = prevGeneration + 1;
+
+    (void) !pwrite(lockFd, &generation, sizeof generation, 0);
+
+    /*
+     * Only consider this write as known if the previous one was:
+     * otherwise, another process changed the log in the meantime and
+     * changed() must stay true.
+     */
+    auto expected = prevGeneration;
+
+    _knownGeneration.compare_exchange_strong(expected, generation);
+}
+
+RecentEmojisLog::Contents RecentEmojisLog::load()
+{
+    {
+        /*
+         * Drain the writer: reading before it writes our own queued
+         * operations would make them look known (see _bumpGeneration())
+         * while they're missing from the returned contents.
+         */
+        std::unique_lock<std::mutex> lock {_mutex};
+
+        _idleCv.wait(lock, [this] {
+            return _ops.empty() && !_busy;
+        });
+    }
+
+    const auto lockFd = this->_lock(LOCK_SH);
+    auto contents = this->_loadUnlocked();
+
+    if (lockFd >= 0) {
+        _knownGeneration = _readGeneration(lockFd);
+        close(lockFd);
+    }
+
+    return contents;
+}
+
+bool RecentEmojisLog::changed() const
+{
+    const auto knownGeneration = _knownGeneration.load();
+
+    if (knownGeneration == _noGeneration) {
+        return true;
+    }
+
+    const auto fd = open(_lockPath.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return true;
+    }
+
+    // no lock: a torn read only means a useless reload
+    const auto generation = _readGeneration(fd);
+
+    close(fd);
+    return generation != knownGeneration;
+}
+
+void RecentEmojisLog::append(std::string emojiStr, std::string findTerms)
+{
+    {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        // coalesce with a queued append
+        if (_ops.empty() || _ops.back().replace) {
+            _ops.push_back({false, {}, {}});
+        }
+
+        _ops.back().emojiStrs.push_back(std::move(emojiStr));
+        _ops.back().findTerms.push_back(std::move(findTerms));
+    }
+
+    _cv.notify_one();
+}
+
+void RecentEmojisLog::replace(std::vector<std::string> emojiStrs)
+{
+    {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        _ops.push_back({true, std::move(emojiStrs), {}});
+    }
+
+    _cv.notify_one();
+}
+
+void RecentEmojisLog::_writerThreadMain()
+{
+    while (true) {
+        _Op op;
+
+        {
+            std::unique_lock<std::mutex> lock {_mutex};
+
+            _cv.wait(lock, [this] {
+                return _stop || !_ops.empty();
+            });
+
+            if (_ops.empty()) {
+                // stopping and nothing left to write
+                return;
+            }
+
+            op = std::move(_ops.front());
+            _ops.pop_front();
+            _busy = true;
+        }
+
+        if (op.replace) {
+            this->_replace(op.emojiStrs);
+        } else {
+            this->_append(op);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock {_mutex};
+
+            _busy = false;
+        }
+
+        _idleCv.notify_all();
+    }
+}
+
+void RecentEmojisLog::_append(const _Op& op)
+{
+    const auto timeStr = std::to_string(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    std::string data;
+    std::size_t lineCount = 0;
+
+    for (std::size_t i = 0; i < op.emojiStrs.size(); ++i) {
+        const auto& emojiStr = op.emojiStrs[i];
+
+        data += emojiStr + '\t' + timeStr + '\n';
+        ++lineCount;
+
+        // one pick affinity line per find term prefix
+        for (const auto& prefix : PickAffinity<std::string>::prefixes(op.findTerms[i])) {
+            data += emojiStr + '\t' + timeStr + "\t1\t" + prefix + '\n';
+            ++lineCount;
+        }
+    }
+
+    {
+        // exclusive: also increments the generation (short anyway)
+        const auto lockFd = this->_lock(LOCK_EX);
+        const auto fd = open(_path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+
+        if (fd >= 0) {
+            // single write of a few bytes
+            (void) !write(fd, data.data(), data.size());
+            close(fd);
+        }
+
+        this->_bumpGeneration(lockFd);
+
+        if (lockFd >= 0) {
+            close(lockFd);
+        }
+    }
+
+    _lineCount += lineCount;
+
+    if (_lineCount >= _compactLineCount) {
+        this->_compact();
+    }
+}
+
+void RecentEmojisLog::_rewrite(const Contents& contents)
+{
+    const auto tmpPath = _path + ".tmp";
+    const auto now = std::chrono::system_clock::now();
+    const auto time = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    const auto emojiCount = std::min(contents.emojiStrs.size(), maxEmojiCount);
+    auto lineCount = emojiCount;
+
+    {
+        std::ofstream file {tmpPath, std::ios::trunc};
+
+        // most recent last, decayed to now
+        for (auto i = emojiCount; i > 0; --i) {
+            const auto& emojiStr = contents.emojiStrs[i - 1];
+
+            file << emojiStr << '\t' << time << '\t' << contents.usage.count(emojiStr, now) << '\n';
+        }
+
+        for (const auto& [prefix, picks] : contents.affinity.picks()) {
+            for (const auto& emojiStrScorePair : picks.scores()) {
+                const auto& emojiStr = emojiStrScorePair.first;
+                const auto count = picks.count(emojiStr, now);
+
+                if (count < _minPickCount) {
+                    // faded away
+                    continue;
+                }
+
+                file << emojiStr << '\t' << time << '\t' << count << '\t' << prefix << '\n';
+                ++lineCount;
+            }
+        }
+    }
+
+    // atomic for readers
+    std::rename(tmpPath.c_str(), _path.c_str());
+
+    // compact again once it doubles
+    _lineCount = lineCount;
+    _compactLineCount = std::max(_minCompactLineCount, _lineCount * 2);
+}
+
+void RecentEmojisLog::_replace(const std::vector<std::string>& emojiStrs)
+{
+    const auto lockFd = this->_lock(LOCK_EX);
+
+    this->_rewrite({emojiStrs, UsageStore<std::string> {maxEmojiCount}, PickAffinity<std::string> {}});
+    this->_bumpGeneration(lockFd);
+
+    if (lockFd >= 0) {
+        close(lockFd);
+    }
+}
+
+void RecentEmojisLog::_compact()
+{
+    // the other processes may have appended too: start from the file
+    const auto lockFd = this->_lock(LOCK_EX);
+
+    // same recent emojis: same generation
+    this->_rewrite(this->_loadUnlocked());
+
+    if (lockFd >= 0) {
+        close(lockFd);
+    }
+}
+
+} // namespace jome
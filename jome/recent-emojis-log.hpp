@@ -0,0 +1,192 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_RECENT_EMOJIS_LOG_HPP
+#define _JOME_RECENT_EMOJIS_LOG_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pick-affinity.hpp"
+#include "usage-store.hpp"
+
+namespace jome {
+
+/*
+ * Append-only log of accepted emojis, shared by all the jome processes
+ * of a user.
+ *
+ * The log file contains one emoji string (UTF-8) per line, the most
+ * recent one last, followed with a tab and the time of the accept (Unix
+ * seconds). The recent emojis are the unique emojis of the log, from
+ * the last line.
+ *
+ * The log is also a usage store: each line counts as one use of its
+ * emoji at its time (see `UsageStore`).
+ *
+ * A line may also be a pick affinity line: the emoji string, a tab, the
+ * time, a tab, the pick count, a tab, and a find term prefix (see
+ * `PickAffinity`). Such a line doesn't count as a use.
+ *
+ * Once in a while, the writer compacts the log: it rewrites it with
+ * only the last occurrence of the `maxEmojiCount` most recent emojis,
+ * each line followed with another tab and the decayed use count of its
+ * emoji at its time, followed with the decayed pick affinity lines.
+ *
+ * append() and replace() only queue an operation: a background writer
+ * thread performs the disk I/O. The destructor waits for the writer to
+ * complete all the queued operations.
+ *
+ * An advisory lock file (`PATH.lock`) keeps the writers of different
+ * processes from stepping on each other. It also contains the
+ * generation of the log, which each write increments: changed() tells
+ * whether or not another process changed the log since the last
+ * load(), and watchPath() is the file to watch to know when to call it.
+ */
+class RecentEmojisLog final
+{
+public:
+    /*
+     * Contents of a log.
+     */
+    struct Contents final
+    {
+        // unique emoji strings, the most recent first
+        std::vector<std::string> emojiStrs;
+
+        // decayed use counts
+        UsageStore<std::string> usage;
+
+        // decayed pick counts by find term prefix
+        PickAffinity<std::string> affinity;
+    };
+
+public:
+    // maximum number of emojis which compacting keeps
+    static constexpr std::size_t maxEmojiCount = 1024;
+
+public:
+    /*
+     * Builds a log using the file `path`, whose directory must exist.
+     */
+    explicit RecentEmojisLog(std::string path);
+
+    RecentEmojisLog(const RecentEmojisLog&) = delete;
+    RecentEmojisLog& operator=(const RecentEmojisLog&) = delete;
+    ~RecentEmojisLog();
+
+    /*
+     * Whether or not the log file exists.
+     */
+    bool exists() const;
+
+    /*
+     * Reads and returns the contents of the log file.
+     *
+     * Waits for the queued operations first: the contents include them.
+     */
+    Contents load();
+
+    /*
+     * Whether or not another process changed the log since the last
+     * load() (always true before the first one).
+     */
+    bool changed() const;
+
+    /*
+     * Path of the file which changes whenever any process writes the
+     * log (see `QFileSystemWatcher`).
+     */
+    const std::string& watchPath() const noexcept
+    {
+        return _lockPath;
+    }
+
+    /*
+     * Queues appending `emojiStr` as the most recent emoji, picked
+     * after typing the normalized find terms `findTerms` (may
+     * be empty).
+     */
+    void append(std::string emojiStr, std::string findTerms = {});
+
+    /*
+     * Queues replacing the whole log with `emojiStrs` (the most
+     * recent first), without any use count.
+     */
+    void replace(std::vector<std::string> emojiStrs);
+
+private:
+    /*
+     * Queued operation: append if `replace` is false.
+     *
+     * When appending, `findTerms[i]` are the find terms of
+     * `emojiStrs[i]`.
+     */
+    struct _Op final
+    {
+        bool replace;
+        std::vector<std::string> emojiStrs;
+        std::vector<std::string> findTerms;
+    };
+
+private:
+    void _writerThreadMain();
+    void _append(const _Op& op);
+    void _replace(const std::vector<std::string>& emojiStrs);
+    void _compact();
+    void _rewrite(const Contents& contents);
+    Contents _loadUnlocked() const;
+    int _lock(int operation) const;
+    void _bumpGeneration(int lockFd);
+    static std::uint64_t _readGeneration(int lockFd);
+
+private:
+    // minimum number of lines before compacting
+    static constexpr std::size_t _minCompactLineCount = 1024;
+
+    // minimum pick count of a pick affinity line which compacting keeps
+    static constexpr double _minPickCount = .01;
+
+    // unknown generation
+    static constexpr std::uint64_t _noGeneration = UINT64_MAX;
+
+private:
+    const std::string _path;
+    const std::string _lockPath;
+
+    // last generation which this object read or wrote
+    std::atomic<std::uint64_t> _knownGeneration {_noGeneration};
+
+    // protects `_ops`, `_busy`, and `_stop`
+    std::mutex _mutex;
+    std::condition_variable _cv;
+    std::deque<_Op> _ops;
+    bool _stop = false;
+
+    // whether or not the writer thread performs an operation
+    bool _busy = false;
+
+    // notified when the writer thread completes all the operations
+    std::condition_variable _idleCv;
+
+    // writer thread only: known line count, and count to compact at
+    std::size_t _lineCount = 0;
+    std::size_t _compactLineCount = _minCompactLineCount;
+
+    std::thread _writerThread;
+};
+
+} // namespace jome
+
+#endif // _JOME_RECENT_EMOJIS_LOG_HPP
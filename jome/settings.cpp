@@ -7,72 +7,111 @@
 
 #include <QSettings>
 #include <QMainWindow>
+#include <QFileInfo>
+#include <QDir>
 #include <vector>
-#include <functional>
 
 #include "settings.hpp"
 
 namespace jome {
 
-void updateRecentEmojisFromSettings(EmojiDb& db)
+std::string recentEmojisLogPath()
 {
-    if (!db.recentEmojisCat()) {
-        return;
-    }
+    const auto dir = QFileInfo {QSettings {}.fileName()}.absoluteDir();
+
+    dir.mkpath(".");
+    return dir.filePath("recent-emojis.log").toStdString();
+}
+
+namespace {
 
+/*
+ * Returns the recent emoji strings of the settings (older jome).
+ */
+std::vector<std::string> recentEmojiStrsFromSettings()
+{
     QSettings settings;
     const auto recentEmojisVar = settings.value("recent-emojis");
 
     if (!recentEmojisVar.canConvert<QList<QVariant>>()) {
-        return;
+        return {};
     }
 
-    const auto recentEmojisList = recentEmojisVar.toList();
-    std::vector<const Emoji *> recentEmojis;
-
-    for (const auto& emojiStrVar : recentEmojisList) {
-        if (!emojiStrVar.canConvert<QString>()) {
-            continue;
-        }
-
-        const auto byteArray = emojiStrVar.toString().toUtf8();
-        const auto emojiStr = byteArray.constData();
+    std::vector<std::string> emojiStrs;
 
-        /*
-         * Silently ignore invalid emoji: this may happen when
-         * `emojis.json` is fixed between releases.
-         */
-        if (db.hasEmoji(emojiStr)) {
-            recentEmojis.push_back(&db.emojiForStr(emojiStr));
+    for (const auto& emojiStrVar : recentEmojisVar.toList()) {
+        if (emojiStrVar.canConvert<QString>()) {
+            emojiStrs.push_back(emojiStrVar.toString().toStdString());
         }
     }
 
-    db.recentEmojis(std::move(recentEmojis));
+    return emojiStrs;
 }
 
-void updateSettings(const EmojiDb& db)
+} // namespace
+
+bool updateRecentEmojisFromLog(EmojiDb& db, RecentEmojisLog& log)
 {
     if (!db.recentEmojisCat()) {
-        return;
+        return false;
     }
 
-    const auto emojiList = std::invoke([&db] {
-        QList<QVariant> emojiList;
+    RecentEmojisLog::Contents contents;
 
-        for (const auto emoji : db.recentEmojisCat()->emojis()) {
-            const auto emojiStr = emoji->str();
+    if (log.exists()) {
+        if (!log.changed()) {
+            // only this process wrote since the last load
+            return false;
+        }
 
-            emojiList.append(emojiStr);
+        contents = log.load();
+    } else {
+        // first run with a log: migrate
+        contents.emojiStrs = recentEmojiStrsFromSettings();
+        log.replace(contents.emojiStrs);
+    }
+
+    std::vector<const Emoji *> recentEmojis;
+    UsageStore<const Emoji *> usage {
+        contents.usage.maxSize(), contents.usage.halfLife(), contents.usage.refTime()
+    };
+
+    for (const auto& [utf8EmojiStr, score] : contents.usage.scores()) {
+        const auto emojiStr = QString::fromStdString(utf8EmojiStr);
+
+        if (db.hasEmoji(emojiStr)) {
+            usage.score(&db.emojiForStr(emojiStr), score);
         }
+    }
 
-        return emojiList;
-    });
+    PickAffinity<const Emoji *> affinity {
+        contents.affinity.maxPrefixCount(), contents.affinity.maxPicksPerPrefix(),
+        contents.affinity.halfLife(), contents.affinity.refTime()
+    };
 
-    // update settings and write immediately
-    QSettings settings;
+    for (const auto& [prefix, picks] : contents.affinity.picks()) {
+        for (const auto& [utf8EmojiStr, score] : picks.scores()) {
+            const auto emojiStr = QString::fromStdString(utf8EmojiStr);
 
-    settings.setValue("recent-emojis", emojiList);
-    settings.sync();
+            if (db.hasEmoji(emojiStr)) {
+                affinity.addScore(prefix, &db.emojiForStr(emojiStr), score);
+            }
+        }
+    }
+
+    for (const auto& utf8EmojiStr : contents.emojiStrs) {
+        const auto emojiStr = QString::fromStdString(utf8EmojiStr);
+
+        /*
+         * Silently ignore invalid emoji: this may happen when
+         * `emojis.json` is fixed between releases.
+         */
+        if (db.hasEmoji(emojiStr)) {
+            recentEmojis.push_back(&db.emojiForStr(emojiStr));
+        }
+    }
+
+    return db.recentEmojis(std::move(recentEmojis), std::move(usage), std::move(affinity));
 }
 
 void saveWindowGeometry(const QMainWindow& window)
@@ -9,22 +9,30 @@
 #define _JOME_SETTINGS_HPP
 
 #include <QSettings>
+#include <string>
 
 #include "emoji-db.hpp"
+#include "recent-emojis-log.hpp"
 
 class QMainWindow;
 
 namespace jome {
 
 /*
- * Updates the recent emojis of `db` from the settings.
+ * Returns the path of the recent emoji log file, next to the settings
+ * file, creating its directory if needed.
  */
-void updateRecentEmojisFromSettings(EmojiDb& db);
+std::string recentEmojisLogPath();
 
 /*
- * Updates the settings from the recent emojis of `db`.
+ * Updates the recent emojis of `db` from the log `log` if another
+ * process changed it, returning true if the "Recent" category of `db`
+ * changed.
+ *
+ * If the log file doesn't exist yet, then migrates the recent emojis
+ * from the settings (older jome) to `log`.
  */
-void updateSettings(const EmojiDb& db);
+bool updateRecentEmojisFromLog(EmojiDb& db, RecentEmojisLog& log);
 
 /*
  * Saves the geometry of `window` to the settings.
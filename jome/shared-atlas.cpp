@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <QByteArray>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.hpp"
+#include "shared-atlas.hpp"
+
+namespace jome {
+namespace {
+
+// magic of a shared atlas file (version 1)
+constexpr char sharedAtlasMagic[8] = {'J', 'O', 'M', 'E', 'A', 'T', 'L', '1'};
+
+/*
+ * Header of a shared atlas file, followed with the pixels.
+ */
+struct SharedAtlasHeader final
+{
+    char magic[8];
+    std::uint32_t width;
+    std::uint32_t height;
+    std::uint32_t bytesPerLine;
+    std::uint32_t format;
+};
+
+/*
+ * Memory mapping of a shared atlas file.
+ *
+ * `fd` holds a shared lock on the file while it's mapped: the
+ * processes which use the file are the ones which hold such a lock.
+ */
+struct SharedAtlasMapping final
+{
+    void *addr;
+    std::size_t size;
+    int fd;
+    QString path;
+};
+
+/*
+ * Returns whether or not the open file `fd` is still the file `path`.
+ */
+bool isSameFile(const int fd, const QString& path)
+{
+    struct stat fdSt, pathSt;
+
+    return fstat(fd, &fdSt) == 0 && stat(QFile::encodeName(path).constData(), &pathSt) == 0 &&
+           fdSt.st_dev == pathSt.st_dev && fdSt.st_ino == pathSt.st_ino;
+}
+
+/*
+ * Unmaps `mapping`, removing its file if no other process uses it.
+ */
+void unmapSharedAtlas(const SharedAtlasMapping& mapping)
+{
+    munmap(mapping.addr, mapping.size);
+
+    // last user: free its memory (the runtime directory is usually a tmpfs)
+    if (flock(mapping.fd, LOCK_EX | LOCK_NB) == 0 && isSameFile(mapping.fd, mapping.path)) {
+        unlink(QFile::encodeName(mapping.path).constData());
+    }
+
+    close(mapping.fd);
+}
+
+/*
+ * Returns the image of the shared atlas file `path`, mapped read-only,
+ * or a null image if not available.
+ */
+QImage mapSharedAtlas(const QString& path)
+{
+    const auto fd = open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+
+    if (fd < 0) {
+        return {};
+    }
+
+    struct stat st;
+
+    /*
+     * The last user of the file may have removed it between open() and
+     * flock(): don't use it then, as nobody else would find it.
+     */
+    if (flock(fd, LOCK_SH) < 0 || !isSameFile(fd, path) || fstat(fd, &st) < 0 ||
+            static_cast<std::size_t>(st.st_size) < sizeof(SharedAtlasHeader)) {
+        close(fd);
+        return {};
+    }
+
+    const auto size = static_cast<std::size_t>(st.st_size);
+    const auto addr = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+
+    if (addr == MAP_FAILED) {
+        close(fd);
+        return {};
+    }
+
+    const SharedAtlasMapping mapping {addr, size, fd, path};
+
+    SharedAtlasHeader header;
+
+    std::memcpy(&header, addr, sizeof header);
+
+    constexpr std::uint64_t maxDim = std::numeric_limits<int>::max();
+
+    if (std::memcmp(header.magic, sharedAtlasMagic, sizeof header.magic) != 0 ||
+            header.format != static_cast<std::uint32_t>(QImage::Format_ARGB32_Premultiplied) ||
+            header.width > maxDim || header.height > maxDim || header.bytesPerLine > maxDim ||
+            header.bytesPerLine < std::uint64_t {header.width} * 4 ||
+            sizeof header + std::uint64_t {header.bytesPerLine} * header.height != size) {
+        // not ours, corrupted, or truncated
+        unmapSharedAtlas(mapping);
+        return {};
+    }
+
+    // unmapped once the image (and all its copies) are gone
+    return QImage {
+        static_cast<const uchar *>(addr) + sizeof header,
+        static_cast<int>(header.width), static_cast<int>(header.height),
+        static_cast<qsizetype>(header.bytesPerLine), QImage::Format_ARGB32_Premultiplied,
+        [](void * const info) {
+            const auto mapping = static_cast<SharedAtlasMapping *>(info);
+
+            unmapSharedAtlas(*mapping);
+            delete mapping;
+        },
+        new SharedAtlasMapping {mapping}
+    };
+}
+
+/*
+ * Publishes the decoded atlas `image` as the shared atlas file `path`,
+ * returning true on success.
+ */
+bool publishSharedAtlas(const QImage& image, const QString& path)
+{
+    const auto tmpPath = qFmtFormat("{}.{}.tmp", path.toStdString(), getpid());
+
+    {
+        QFile file {tmpPath};
+
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            return false;
+        }
+
+        SharedAtlasHeader header;
+
+        std::memcpy(header.magic, sharedAtlasMagic, sizeof header.magic);
+        header.width = static_cast<std::uint32_t>(image.width());
+        header.height = static_cast<std::uint32_t>(image.height());
+        header.bytesPerLine = static_cast<std::uint32_t>(image.bytesPerLine());
+        header.format = image.format();
+
+        const auto dataSize = static_cast<qint64>(image.sizeInBytes());
+
+        if (file.write(reinterpret_cast<const char *>(&header), sizeof header) !=
+                    static_cast<qint64>(sizeof header) ||
+                file.write(reinterpret_cast<const char *>(image.constBits()), dataSize) !=
+                    dataSize ||
+                !file.flush()) {
+            file.remove();
+            return false;
+        }
+    }
+
+    // atomic for the other processes
+    if (std::rename(QFile::encodeName(tmpPath).constData(),
+                    QFile::encodeName(path).constData()) != 0) {
+        QFile::remove(tmpPath);
+        return false;
+    }
+
+    return true;
+}
+
+/*
+ * Removes the shared atlas files of the directory `dir` having the name
+ * prefix `prefix`, except `keepName`.
+ *
+ * The processes which still map them keep their contents.
+ */
+void removeStaleSharedAtlases(const QDir& dir, const QString& prefix, const QString& keepName)
+{
+    for (const auto& name : dir.entryList({prefix + '*'}, QDir::Files)) {
+        if (name != keepName && !name.endsWith(".tmp")) {
+            dir.remove(name);
+        }
+    }
+}
+
+} // namespace
+
+QImage loadSharedAtlas(const QString& pngPath)
+{
+    const auto dirPath = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    QFile pngFile {pngPath};
+
+    if (dirPath.isEmpty() || !pngFile.open(QIODevice::ReadOnly)) {
+        return QImage {pngPath}.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    }
+
+    // versioned by contents: a new PNG file gets another shared atlas
+    const auto pngData = pngFile.readAll();
+    const auto hash = QCryptographicHash::hash(pngData, QCryptographicHash::Sha1).toHex().left(16);
+    const auto prefix = qFmtFormat("jome-{}-", QFileInfo {pngPath}.completeBaseName().toStdString());
+    const auto name = prefix + QString::fromLatin1(hash);
+    const QDir dir {dirPath};
+
+    if (auto image = mapSharedAtlas(dir.filePath(name)); !image.isNull()) {
+        // another process already decoded it
+        return image;
+    }
+
+    // first one: decode and publish
+    auto image = QImage::fromData(pngData, "PNG").convertToFormat(
+        QImage::Format_ARGB32_Premultiplied);
+
+    if (image.isNull() || !publishSharedAtlas(image, dir.filePath(name))) {
+        return image;
+    }
+
+    removeStaleSharedAtlases(dir, prefix, name);
+
+    // share its pages from now on
+    if (auto sharedImage = mapSharedAtlas(dir.filePath(name)); !sharedImage.isNull()) {
+        return sharedImage;
+    }
+
+    return image;
+}
+
+} // namespace jome
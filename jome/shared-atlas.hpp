@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_SHARED_ATLAS_HPP
+#define _JOME_SHARED_ATLAS_HPP
+
+#include <QImage>
+#include <QString>
+
+namespace jome {
+
+/*
+ * Returns the decoded image of the emoji atlas PNG file `pngPath`.
+ *
+ * The first jome process which needs this atlas decodes the PNG file
+ * and publishes the decoded pixels into a file of the user runtime
+ * directory (usually a tmpfs), named after the hash of the contents of
+ * the PNG file. The other jome processes map this file read-only
+ * instead of decoding the PNG file again: they all share the same
+ * memory pages.
+ *
+ * The last process which unmaps this file (when the returned image and
+ * all its copies are gone) removes it, freeing its memory.
+ *
+ * Falls back to a private decoded image without any runtime directory
+ * or if anything else fails.
+ */
+QImage loadSharedAtlas(const QString& pngPath);
+
+} // namespace jome
+
+#endif // _JOME_SHARED_ATLAS_HPP
@@ -0,0 +1,228 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "stats.hpp"
+
+namespace jome {
+
+unsigned int LatencyHistogram::_bucketIndex(const std::uint64_t val) noexcept
+{
+    if (val < _subBucketCount) {
+        // linear
+        return static_cast<unsigned int>(val);
+    }
+
+    // position of the most significant bit
+    const auto msb = 63U - static_cast<unsigned int>(__builtin_clzll(val));
+
+    // next bits (below the most significant bit) select the sub-bucket
+    const auto sub = static_cast<unsigned int>((val >> (msb - _subBucketBits)) &
+                                               (_subBucketCount - 1));
+
+    return (msb - _subBucketBits + 1) * _subBucketCount + sub;
+}
+
+std::uint64_t LatencyHistogram::_bucketLowerBound(const unsigned int index) noexcept
+{
+    if (index < _subBucketCount) {
+        return index;
+    }
+
+    const auto msb = index / _subBucketCount + _subBucketBits - 1;
+    const auto sub = index % _subBucketCount;
+
+    return static_cast<std::uint64_t>(_subBucketCount + sub) << (msb - _subBucketBits);
+}
+
+std::uint64_t LatencyHistogram::_bucketUpperBound(const unsigned int index) noexcept
+{
+    if (index < _subBucketCount) {
+        return index;
+    }
+
+    const auto msb = index / _subBucketCount + _subBucketBits - 1;
+
+    return _bucketLowerBound(index) + (std::uint64_t {1} << (msb - _subBucketBits)) - 1;
+}
+
+void LatencyHistogram::record(const std::chrono::steady_clock::duration duration) noexcept
+{
+    const auto us = static_cast<std::uint64_t>(
+        std::max(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(),
+                 std::chrono::microseconds::rep {0})
+    );
+
+    ++_counts[_bucketIndex(us)];
+
+    if (_count == 0) {
+        _min = us;
+        _max = us;
+    } else {
+        _min = std::min(_min, us);
+        _max = std::max(_max, us);
+    }
+
+    ++_count;
+    _sum += us;
+}
+
+std::uint64_t LatencyHistogram::_percentile(const double percentile) const noexcept
+{
+    assert(_count > 0);
+
+    const auto target = std::max(static_cast<std::uint64_t>(percentile / 100. * _count),
+                                 std::uint64_t {1});
+    std::uint64_t cumCount = 0;
+
+    for (auto i = 0U; i < _bucketCount; ++i) {
+        cumCount += _counts[i];
+
+        if (cumCount >= target) {
+            return std::clamp(_bucketUpperBound(i), _min, _max);
+        }
+    }
+
+    return _max;
+}
+
+nlohmann::json LatencyHistogram::toJson() const
+{
+    auto jsonHisto = nlohmann::json::object();
+
+    jsonHisto["count"] = _count;
+
+    if (_count == 0) {
+        return jsonHisto;
+    }
+
+    jsonHisto["min-us"] = _min;
+    jsonHisto["mean-us"] = _sum / _count;
+    jsonHisto["max-us"] = _max;
+    jsonHisto["p50-us"] = this->_percentile(50);
+    jsonHisto["p90-us"] = this->_percentile(90);
+    jsonHisto["p99-us"] = this->_percentile(99);
+    jsonHisto["p99.9-us"] = this->_percentile(99.9);
+
+    // non-empty buckets as `[LOWER, UPPER, COUNT]` arrays
+    auto jsonBuckets = nlohmann::json::array();
+
+    for (auto i = 0U; i < _bucketCount; ++i) {
+        if (_counts[i] > 0) {
+            jsonBuckets.push_back({_bucketLowerBound(i), _bucketUpperBound(i), _counts[i]});
+        }
+    }
+
+    jsonHisto["buckets"] = std::move(jsonBuckets);
+    return jsonHisto;
+}
+
+Stats::Stats() :
+    _startTime {std::chrono::steady_clock::now()}
+{
+}
+
+void Stats::increment(const Counter counter)
+{
+    std::lock_guard<std::mutex> lock {_mutex};
+
+    ++_counters[static_cast<std::size_t>(counter)];
+}
+
+void Stats::countAccept(const std::optional<Emoji::SkinTone> skinTone)
+{
+    std::lock_guard<std::mutex> lock {_mutex};
+
+    ++_accepts[skinTone ? static_cast<std::size_t>(*skinTone) + 1 : 0];
+}
+
+void Stats::record(const Latency latency, const std::chrono::steady_clock::duration duration)
+{
+    std::lock_guard<std::mutex> lock {_mutex};
+
+    _histograms[static_cast<std::size_t>(latency)].record(duration);
+}
+
+std::string Stats::toJson() const
+{
+    static const char * const counterNames[] = {
+        "pick-requests",
+        "find-requests",
+        "cancels",
+        "find-box-queries",
+        "tile-cache-hits",
+        "tile-cache-misses",
+        "commands",
+        "command-failures",
+        "reloads",
+        "reload-failures",
+        "releases",
+    };
+
+    static const char * const skinToneNames[] = {
+        "none",
+        "light",
+        "medium-light",
+        "medium",
+        "medium-dark",
+        "dark",
+    };
+
+    static const char * const latencyNames[] = {
+        "pick-to-visible",
+        "keystroke-to-results",
+        "rebuild",
+        "accept-to-reply",
+    };
+
+    static_assert(std::size(counterNames) == _counterCount);
+    static_assert(std::size(skinToneNames) == _skinToneCount);
+    static_assert(std::size(latencyNames) == _latencyCount);
+
+    std::lock_guard<std::mutex> lock {_mutex};
+    auto jsonStats = nlohmann::json::object();
+
+    jsonStats["uptime-s"] = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - _startTime
+    ).count();
+
+    // counters
+    auto jsonCounters = nlohmann::json::object();
+    std::uint64_t acceptCount = 0;
+
+    for (std::size_t i = 0; i < _counterCount; ++i) {
+        jsonCounters[counterNames[i]] = _counters[i];
+    }
+
+    {
+        auto jsonAccepts = nlohmann::json::object();
+
+        for (std::size_t i = 0; i < _skinToneCount; ++i) {
+            jsonAccepts[skinToneNames[i]] = _accepts[i];
+            acceptCount += _accepts[i];
+        }
+
+        jsonCounters["accepts"] = acceptCount;
+        jsonCounters["accepts-per-skin-tone"] = std::move(jsonAccepts);
+    }
+
+    jsonStats["counters"] = std::move(jsonCounters);
+
+    // histograms
+    auto jsonHistos = nlohmann::json::object();
+
+    for (std::size_t i = 0; i < _latencyCount; ++i) {
+        jsonHistos[latencyNames[i]] = _histograms[i].toJson();
+    }
+
+    jsonStats["latencies"] = std::move(jsonHistos);
+    return jsonStats.dump(2) + '\n';
+}
+
+} // namespace jome
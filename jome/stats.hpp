@@ -0,0 +1,167 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_STATS_HPP
+#define _JOME_STATS_HPP
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <nlohmann/json.hpp>
+
+#include "emoji-db.hpp"
+
+namespace jome {
+
+/*
+ * Log-linear latency histogram (HDR style).
+ *
+ * Records durations with a microsecond resolution into buckets: eight
+ * linear sub-buckets per power of two, so that the relative error of a
+ * recorded value is at most 12.5 %, whatever its magnitude, with a
+ * fixed memory footprint.
+ */
+class LatencyHistogram final
+{
+public:
+    /*
+     * Records the duration `duration`.
+     */
+    void record(std::chrono::steady_clock::duration duration) noexcept;
+
+    /*
+     * Returns a JSON object with the count, the minimum, mean, and
+     * maximum values, a few percentiles, and the non-empty buckets
+     * (microseconds).
+     */
+    nlohmann::json toJson() const;
+
+private:
+    // number of linear sub-buckets per power of two, as a power of two
+    static constexpr unsigned int _subBucketBits = 3;
+
+    static constexpr unsigned int _subBucketCount = 1U << _subBucketBits;
+    static constexpr unsigned int _bucketCount = (64 - _subBucketBits + 1) * _subBucketCount;
+
+private:
+    static unsigned int _bucketIndex(std::uint64_t val) noexcept;
+    static std::uint64_t _bucketLowerBound(unsigned int index) noexcept;
+    static std::uint64_t _bucketUpperBound(unsigned int index) noexcept;
+    std::uint64_t _percentile(double percentile) const noexcept;
+
+private:
+    std::array<std::uint64_t, _bucketCount> _counts {};
+    std::uint64_t _count = 0;
+    std::uint64_t _sum = 0;
+    std::uint64_t _min = 0;
+    std::uint64_t _max = 0;
+};
+
+/*
+ * Runtime statistics of a jome process: counters and latency
+ * histograms.
+ *
+ * All the methods are thread-safe.
+ */
+class Stats final
+{
+public:
+    /*
+     * Counter.
+     */
+    enum class Counter
+    {
+        // `pick` requests received by the server
+        PickRequests,
+
+        // `find` requests received by the server
+        FindRequests,
+
+        // cancelled picks
+        Cancels,
+
+        // find box queries
+        FindBoxQueries,
+
+        // category tile cache hits and misses (`-T` option)
+        TileCacheHits,
+        TileCacheMisses,
+
+        // started and failed external commands (`-c` option)
+        Commands,
+        CommandFailures,
+
+        // emoji database and user keyword reloads and failed ones
+        Reloads,
+        ReloadFailures,
+
+        // memory releases of the hidden window (`-I` option)
+        Releases,
+    };
+
+    /*
+     * Latency histogram.
+     */
+    enum class Latency
+    {
+        // from the reception of a `pick` request to the shown window
+        PickToVisible,
+
+        // from a find box change to the shown find results
+        KeystrokeToResults,
+
+        // rebuilding the emoji grid (first screenful only with `-g`)
+        Rebuild,
+
+        // from accepting an emoji to having sent the reply to the client
+        AcceptToReply,
+    };
+
+public:
+    Stats();
+
+    /*
+     * Increments the counter `counter`.
+     */
+    void increment(Counter counter);
+
+    /*
+     * Counts an accepted emoji with the skin tone `skinTone`.
+     */
+    void countAccept(std::optional<Emoji::SkinTone> skinTone);
+
+    /*
+     * Records the duration `duration` into the histogram `latency`.
+     */
+    void record(Latency latency, std::chrono::steady_clock::duration duration);
+
+    /*
+     * Returns all the statistics as a JSON document.
+     */
+    std::string toJson() const;
+
+private:
+    static constexpr std::size_t _counterCount = 11;
+    static constexpr std::size_t _latencyCount = 4;
+
+    // no skin tone and the five skin tones
+    static constexpr std::size_t _skinToneCount = 6;
+
+private:
+    mutable std::mutex _mutex;
+    const std::chrono::steady_clock::time_point _startTime;
+    std::array<std::uint64_t, _counterCount> _counters {};
+    std::array<std::uint64_t, _skinToneCount> _accepts {};
+    std::array<LatencyHistogram, _latencyCount> _histograms;
+};
+
+} // namespace jome
+
+#endif // _JOME_STATS_HPP
@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_USAGE_STORE_HPP
+#define _JOME_USAGE_STORE_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace jome {
+
+/*
+ * Bounded store of exponentially decayed use counts, one per key.
+ *
+ * Each use of a key adds one to its count, and every count halves each
+ * halfLife(). count() returns the decayed count of a key at a given
+ * time.
+ *
+ * Internally, a score is the count of a key scaled to the reference
+ * time refTime(): adding a use at time T adds 2^((T - refTime) /
+ * halfLife) to the score of its key. Therefore add() is O(1) (it doesn't
+ * need to decay the other scores), and comparing the scores of two keys
+ * is the same as comparing their current counts.
+ *
+ * Once the store has twice maxSize() keys, add() removes the keys having
+ * the lowest scores to keep maxSize() keys (amortized O(1)).
+ */
+template <typename KeyT>
+class UsageStore final
+{
+public:
+    using Clock = std::chrono::system_clock;
+    using Duration = std::chrono::duration<double>;
+
+public:
+    /*
+     * Builds an empty store of at most `maxSize` keys having the count
+     * half-life `halfLife` and the reference time `refTime`.
+     */
+    explicit UsageStore(const std::size_t maxSize = 1024,
+                        const Duration halfLife = std::chrono::hours {24 * 14},
+                        const Clock::time_point refTime = Clock::now()) :
+        _maxSize {maxSize},
+        _halfLife {halfLife},
+        _refTime {refTime}
+    {
+    }
+
+    /*
+     * Adds `count` uses of `key` at the time `time`.
+     */
+    void add(const KeyT& key, const double count = 1., const Clock::time_point time = Clock::now())
+    {
+        _scores[key] += count * this->_weight(time);
+
+        if (_scores.size() >= _maxSize * 2) {
+            this->_prune();
+        }
+    }
+
+    /*
+     * Decayed use count of `key` at the time `time`.
+     */
+    double count(const KeyT& key, const Clock::time_point time = Clock::now()) const
+    {
+        return this->score(key) / this->_weight(time);
+    }
+
+    /*
+     * Score of `key` (zero if unknown), only meaningful compared to the
+     * other scores of this store.
+     */
+    double score(const KeyT& key) const
+    {
+        const auto it = _scores.find(key);
+
+        return it == _scores.end() ? 0. : it->second;
+    }
+
+    /*
+     * Sets the score of `key` to `score`, for example to copy a score
+     * from another store having the same reference time and half-life.
+     */
+    void score(const KeyT& key, const double score)
+    {
+        _scores[key] = score;
+    }
+
+    /*
+     * All the scores.
+     */
+    const std::unordered_map<KeyT, double>& scores() const noexcept
+    {
+        return _scores;
+    }
+
+    std::size_t maxSize() const noexcept
+    {
+        return _maxSize;
+    }
+
+    Duration halfLife() const noexcept
+    {
+        return _halfLife;
+    }
+
+    Clock::time_point refTime() const noexcept
+    {
+        return _refTime;
+    }
+
+private:
+    double _weight(const Clock::time_point time) const
+    {
+        return std::exp2(Duration {time - _refTime} / _halfLife);
+    }
+
+    void _prune()
+    {
+        std::vector<std::pair<KeyT, double>> entries {_scores.begin(), _scores.end()};
+
+        std::nth_element(entries.begin(), entries.begin() + _maxSize, entries.end(),
+                         [](const auto& a, const auto& b) {
+            return a.second > b.second;
+        });
+
+        entries.resize(_maxSize);
+        _scores = {entries.begin(), entries.end()};
+    }
+
+private:
+    std::size_t _maxSize;
+    Duration _halfLife;
+    Clock::time_point _refTime;
+    std::unordered_map<KeyT, double> _scores;
+};
+
+} // namespace jome
+
+#endif // _JOME_USAGE_STORE_HPP
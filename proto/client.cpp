@@ -0,0 +1,323 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <utility>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "client.hpp"
+
+namespace jome {
+namespace proto {
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/*
+ * Returns the number of milliseconds from now to `deadline`, or zero
+ * if it's in the past.
+ */
+unsigned int remainingMs(const Clock::time_point deadline)
+{
+    const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - Clock::now());
+
+    return remaining.count() > 0 ? static_cast<unsigned int>(remaining.count()) : 0;
+}
+
+} // namespace
+
+std::string serverSocketPath(const std::string& serverName)
+{
+    if (!serverName.empty() && serverName.front() == '/') {
+        return serverName;
+    }
+
+    // like `QDir::tempPath()`
+    std::string dir = "/tmp";
+
+    if (const auto tmpDir = std::getenv("TMPDIR"); tmpDir && *tmpDir) {
+        dir = tmpDir;
+
+        while (dir.size() > 1 && dir.back() == '/') {
+            dir.pop_back();
+        }
+    }
+
+    if (dir.back() != '/') {
+        dir += '/';
+    }
+
+    return dir + serverName;
+}
+
+Client::Client(std::string serverName) :
+    _serverName {std::move(serverName)}
+{
+}
+
+Client::~Client()
+{
+    this->close();
+}
+
+void Client::close() noexcept
+{
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+bool Client::_fail(const Error error, std::string msg)
+{
+    this->close();
+    _error = error;
+    _errorString = std::move(msg);
+    return false;
+}
+
+bool Client::_failWithErrno(const Error error, const std::string& what)
+{
+    const auto errnoVal = errno;
+
+    return this->_fail(error, what + ": " + std::strerror(errnoVal));
+}
+
+bool Client::connect()
+{
+    this->close();
+    _error = Error::None;
+    _errorString.clear();
+    _tmpData.clear();
+    _handshakeDone = false;
+    _frameDecoder = FrameDecoder {};
+
+    const auto path = serverSocketPath(_serverName);
+    sockaddr_un addr {};
+
+    addr.sun_family = AF_UNIX;
+
+    if (path.size() >= sizeof addr.sun_path) {
+        return this->_fail(Error::System, "socket path `" + path + "` is too long");
+    }
+
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    _fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+    if (_fd < 0) {
+        return this->_failWithErrno(Error::System, "cannot create socket");
+    }
+
+    while (::connect(_fd, reinterpret_cast<const sockaddr *>(&addr), sizeof addr) < 0) {
+        if (errno == EINTR) {
+            continue;
+        }
+
+        const auto error = errno == ENOENT ? Error::ServerNotFound :
+                           errno == ECONNREFUSED ? Error::ConnectionRefused : Error::System;
+
+        return this->_failWithErrno(error, "cannot connect to `" + path + "`");
+    }
+
+    // single write for the handshake and the first request
+    _unsentHandshake = encodeHandshake();
+    return true;
+}
+
+bool Client::_write(const std::string& data)
+{
+    std::size_t at = 0;
+
+    while (at < data.size()) {
+        // no `SIGPIPE` if the server is gone
+        const auto count = ::send(_fd, data.data() + at, data.size() - at, MSG_NOSIGNAL);
+
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return this->_failWithErrno(errno == EPIPE ? Error::Closed : Error::System,
+                                        "cannot send data");
+        }
+
+        at += static_cast<std::size_t>(count);
+    }
+
+    return true;
+}
+
+std::optional<std::uint32_t> Client::sendRequest(const Fields& fields)
+{
+    if (_fd < 0) {
+        this->_fail(Error::Closed, "not connected");
+        return std::nullopt;
+    }
+
+    Frame frame;
+
+    frame.reqId = _nextReqId++;
+    frame.type = FrameType::Request;
+    frame.fields = fields;
+
+    if (!this->_write(_unsentHandshake + encodeFrame(frame))) {
+        return std::nullopt;
+    }
+
+    _unsentHandshake.clear();
+
+    return frame.reqId;
+}
+
+bool Client::_decodeHandshake()
+{
+    if (_tmpData.size() < handshakeSize) {
+        // incomplete
+        return true;
+    }
+
+    if (decodeHandshake(_tmpData.data()) != version) {
+        return this->_fail(Error::Protocol, "unexpected protocol version");
+    }
+
+    // frames follow the handshake
+    _handshakeDone = true;
+    _frameDecoder.append(_tmpData.data() + handshakeSize, _tmpData.size() - handshakeSize);
+    _tmpData.clear();
+    return true;
+}
+
+bool Client::_receiveData(const std::optional<unsigned int> timeoutMs)
+{
+    pollfd pollFd {_fd, POLLIN, 0};
+    const auto ret = ::poll(&pollFd, 1, timeoutMs ? static_cast<int>(*timeoutMs) : -1);
+
+    if (ret < 0) {
+        if (errno == EINTR) {
+            // the caller tries again
+            return true;
+        }
+
+        return this->_failWithErrno(Error::System, "cannot poll socket");
+    }
+
+    if (ret == 0) {
+        // stay connected
+        _error = Error::Timeout;
+        _errorString = "timed out waiting for the server";
+        return false;
+    }
+
+    char buf[64 * 1024];
+    const auto count = ::read(_fd, buf, sizeof buf);
+
+    if (count < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+
+        return this->_failWithErrno(Error::System, "cannot receive data");
+    }
+
+    if (count == 0) {
+        return this->_fail(Error::Closed, "the server closed the connection");
+    }
+
+    if (_handshakeDone) {
+        _frameDecoder.append(buf, static_cast<std::size_t>(count));
+        return true;
+    }
+
+    _tmpData.append(buf, static_cast<std::size_t>(count));
+    return this->_decodeHandshake();
+}
+
+bool Client::handshake(const std::optional<unsigned int> timeoutMs)
+{
+    if (_fd < 0) {
+        return this->_fail(Error::Closed, "not connected");
+    }
+
+    if (!_unsentHandshake.empty()) {
+        if (!this->_write(_unsentHandshake)) {
+            return false;
+        }
+
+        _unsentHandshake.clear();
+    }
+
+    const auto deadline = Clock::now() + std::chrono::milliseconds {timeoutMs.value_or(0)};
+
+    while (!_handshakeDone) {
+        if (!this->_receiveData(timeoutMs ? std::make_optional(remainingMs(deadline)) :
+                                std::nullopt)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+std::optional<Frame> Client::receive(const std::optional<unsigned int> timeoutMs)
+{
+    const auto deadline = Clock::now() + std::chrono::milliseconds {timeoutMs.value_or(0)};
+
+    while (_fd >= 0) {
+        if (_handshakeDone) {
+            if (auto frame = _frameDecoder.next()) {
+                return frame;
+            }
+
+            if (_frameDecoder.error()) {
+                this->_fail(Error::Protocol, "invalid frame");
+                return std::nullopt;
+            }
+        }
+
+        // wait for more data
+        if (!this->_receiveData(timeoutMs ? std::make_optional(remainingMs(deadline)) :
+                                std::nullopt)) {
+            return std::nullopt;
+        }
+    }
+
+    this->_fail(Error::Closed, "not connected");
+    return std::nullopt;
+}
+
+std::optional<Frame> Client::request(const Fields& fields,
+                                     const std::optional<unsigned int> timeoutMs)
+{
+    const auto deadline = Clock::now() + std::chrono::milliseconds {timeoutMs.value_or(0)};
+    const auto reqId = this->sendRequest(fields);
+
+    if (!reqId) {
+        return std::nullopt;
+    }
+
+    while (true) {
+        auto frame = this->receive(timeoutMs ? std::make_optional(remainingMs(deadline)) :
+                                   std::nullopt);
+
+        if (!frame) {
+            return std::nullopt;
+        }
+
+        if (frame->type == FrameType::Reply && frame->reqId == *reqId) {
+            return frame;
+        }
+    }
+}
+
+} // namespace proto
+} // namespace jome
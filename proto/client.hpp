@@ -0,0 +1,193 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_PROTO_CLIENT_HPP
+#define _JOME_PROTO_CLIENT_HPP
+
+#include <cstdint>
+#include <string>
+#include <optional>
+
+#include "proto.hpp"
+
+namespace jome {
+namespace proto {
+
+/*
+ * Returns the path of the socket file of the jome server named
+ * `serverName`, the same as `QLocalSocket` uses:
+ *
+ * • `serverName` itself if it's an absolute path.
+ *
+ * • Otherwise, `serverName` within the `TMPDIR` directory, or within
+ *   `/tmp` if `TMPDIR` isn't set.
+ */
+std::string serverSocketPath(const std::string& serverName);
+
+/*
+ * Synchronous v2 client of a jome server, without any Qt dependency.
+ *
+ * Call connect(), and then sendRequest() and receive(), or request()
+ * to do both. A client may send many requests over a single
+ * connection, without waiting for the previous replies (pipelining):
+ * match a reply to its request with its ID.
+ *
+ * On error, the methods return false or `std::nullopt`, and error()
+ * and errorString() describe the error. Once a method fails, the
+ * client is disconnected, except when receive() times out.
+ *
+ * A client isn't thread-safe.
+ */
+class Client final
+{
+public:
+    /*
+     * Error kind.
+     */
+    enum class Error
+    {
+        // no error
+        None,
+
+        // no socket file
+        ServerNotFound,
+
+        // socket file exists, but nobody listens (stale)
+        ConnectionRefused,
+
+        // receive() timed out
+        Timeout,
+
+        // the server closed the connection
+        Closed,
+
+        // unexpected handshake or invalid frame
+        Protocol,
+
+        // any other system error
+        System,
+    };
+
+public:
+    /*
+     * Builds a client of the jome server named `serverName` (not
+     * connected yet).
+     */
+    explicit Client(std::string serverName);
+
+    Client(const Client&) = delete;
+    Client& operator=(const Client&) = delete;
+    ~Client();
+
+    /*
+     * Connects to the server.
+     *
+     * The client sends its handshake with the first request, and
+     * doesn't wait for the handshake of the server: receive()
+     * handles it.
+     */
+    bool connect();
+
+    /*
+     * Sends the handshake now, if not sent yet, and waits for the
+     * handshake of the server, waiting at most `*timeoutMs`
+     * milliseconds if set.
+     *
+     * Use this to make sure that a v2 server listens before sending a
+     * request of which the reply may take long.
+     */
+    bool handshake(std::optional<unsigned int> timeoutMs = std::nullopt);
+
+    /*
+     * Closes the connection, if any.
+     */
+    void close() noexcept;
+
+    bool isConnected() const noexcept
+    {
+        return _fd >= 0;
+    }
+
+    /*
+     * Sends a request frame having the fields `fields`, returning its
+     * ID on success.
+     */
+    std::optional<std::uint32_t> sendRequest(const Fields& fields);
+
+    /*
+     * Waits for and returns the next received frame, waiting at most
+     * `*timeoutMs` milliseconds if set.
+     *
+     * On timeout, the client stays connected: call receive() with a
+     * zero timeout to get a frame only if one is available now.
+     */
+    std::optional<Frame> receive(std::optional<unsigned int> timeoutMs = std::nullopt);
+
+    /*
+     * Sends a request frame having the fields `fields`, and then waits
+     * for and returns its reply, waiting at most `*timeoutMs`
+     * milliseconds if set.
+     *
+     * This method discards the other received frames.
+     */
+    std::optional<Frame> request(const Fields& fields,
+                                 std::optional<unsigned int> timeoutMs = std::nullopt);
+
+    /*
+     * File descriptor of the connected socket, to poll it, or -1.
+     */
+    int fd() const noexcept
+    {
+        return _fd;
+    }
+
+    const std::string& serverName() const noexcept
+    {
+        return _serverName;
+    }
+
+    Error error() const noexcept
+    {
+        return _error;
+    }
+
+    const std::string& errorString() const noexcept
+    {
+        return _errorString;
+    }
+
+private:
+    bool _fail(Error error, std::string msg);
+    bool _failWithErrno(Error error, const std::string& what);
+    bool _write(const std::string& data);
+    bool _decodeHandshake();
+    bool _receiveData(std::optional<unsigned int> timeoutMs);
+
+private:
+    const std::string _serverName;
+    int _fd = -1;
+
+    // next request ID
+    std::uint32_t _nextReqId = 1;
+
+    // handshake to send with the next request, if any
+    std::string _unsentHandshake;
+
+    // received data not decoded yet (handshake)
+    std::string _tmpData;
+    bool _handshakeDone = false;
+    FrameDecoder _frameDecoder;
+
+    // last error
+    Error _error = Error::None;
+    std::string _errorString;
+};
+
+} // namespace proto
+} // namespace jome
+
+#endif // _JOME_PROTO_CLIENT_HPP
@@ -0,0 +1,241 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#include <cassert>
+#include <cstring>
+#include <unistd.h>
+
+#include "proto.hpp"
+
+namespace jome {
+namespace proto {
+namespace {
+
+void appendUInt(std::string& str, std::uint64_t val, const std::size_t size)
+{
+    for (std::size_t i = 0; i < size; ++i) {
+        str += static_cast<char>(val & 0xff);
+        val >>= 8;
+    }
+}
+
+std::uint64_t readUInt(const char * const data, const std::size_t size) noexcept
+{
+    std::uint64_t val = 0;
+
+    for (std::size_t i = 0; i < size; ++i) {
+        val |= static_cast<std::uint64_t>(static_cast<unsigned char>(data[i])) << (i * 8);
+    }
+
+    return val;
+}
+
+} // namespace
+
+std::optional<std::uint64_t> Frame::uintField(const std::string& key) const
+{
+    const auto it = fields.find(key);
+
+    if (it == fields.end()) {
+        return std::nullopt;
+    }
+
+    if (const auto val = std::get_if<std::uint64_t>(&it->second)) {
+        return *val;
+    }
+
+    return std::nullopt;
+}
+
+const std::string *Frame::strField(const std::string& key) const
+{
+    const auto it = fields.find(key);
+
+    if (it == fields.end()) {
+        return nullptr;
+    }
+
+    return std::get_if<std::string>(&it->second);
+}
+
+std::string defaultServerName()
+{
+    return "jome.socket." + std::to_string(getuid());
+}
+
+std::string encodeHandshake(const unsigned int version)
+{
+    std::string data {handshakeMagic, sizeof handshakeMagic};
+
+    data += static_cast<char>(version);
+    return data;
+}
+
+std::optional<unsigned int> decodeHandshake(const char * const data) noexcept
+{
+    if (std::memcmp(data, handshakeMagic, sizeof handshakeMagic) != 0) {
+        return std::nullopt;
+    }
+
+    return static_cast<unsigned char>(data[sizeof handshakeMagic]);
+}
+
+std::string encodeFrame(const Frame& frame)
+{
+    std::string data;
+
+    // reserve the length prefix, set below
+    appendUInt(data, 0, 4);
+    appendUInt(data, frame.reqId, 4);
+    appendUInt(data, static_cast<std::uint8_t>(frame.type), 1);
+
+    for (const auto& keyValPair : frame.fields) {
+        assert(keyValPair.first.size() <= 0xffff);
+        appendUInt(data, keyValPair.first.size(), 2);
+        data += keyValPair.first;
+
+        if (const auto val = std::get_if<std::uint64_t>(&keyValPair.second)) {
+            appendUInt(data, static_cast<std::uint8_t>(ValueType::UInt), 1);
+            appendUInt(data, *val, 8);
+        } else {
+            const auto& str = std::get<std::string>(keyValPair.second);
+
+            appendUInt(data, static_cast<std::uint8_t>(ValueType::Str), 1);
+            appendUInt(data, str.size(), 4);
+            data += str;
+        }
+    }
+
+    const auto payloadSize = data.size() - 4;
+
+    assert(payloadSize <= maxPayloadSize);
+
+    for (std::size_t i = 0; i < 4; ++i) {
+        data[i] = static_cast<char>((payloadSize >> (i * 8)) & 0xff);
+    }
+
+    return data;
+}
+
+void FrameDecoder::append(const char * const data, const std::size_t size)
+{
+    if (_pos > 0 && _pos == _buf.size()) {
+        // everything is decoded: start over
+        _buf.clear();
+        _pos = 0;
+    } else if (_pos >= 4096 && _pos * 2 >= _buf.size()) {
+        // drop decoded data
+        _buf.erase(0, _pos);
+        _pos = 0;
+    }
+
+    _buf.append(data, size);
+}
+
+std::optional<Frame> FrameDecoder::next()
+{
+    if (_error || this->bufferedSize() < 4) {
+        return std::nullopt;
+    }
+
+    const auto payloadSize = readUInt(_buf.data() + _pos, 4);
+
+    if (payloadSize > maxPayloadSize) {
+        _error = true;
+        return std::nullopt;
+    }
+
+    if (this->bufferedSize() < 4 + payloadSize) {
+        // incomplete
+        return std::nullopt;
+    }
+
+    auto frame = this->_decodePayload(_buf.data() + _pos + 4, payloadSize);
+
+    if (!frame) {
+        _error = true;
+        return std::nullopt;
+    }
+
+    _pos += 4 + payloadSize;
+    return frame;
+}
+
+std::optional<Frame> FrameDecoder::_decodePayload(const char * const data,
+                                                  const std::size_t size) const
+{
+    // request ID and frame type
+    if (size < 5) {
+        return std::nullopt;
+    }
+
+    Frame frame;
+
+    frame.reqId = readUInt(data, 4);
+    frame.type = static_cast<FrameType>(data[4]);
+
+    if (frame.type != FrameType::Request && frame.type != FrameType::Reply &&
+            frame.type != FrameType::Event) {
+        return std::nullopt;
+    }
+
+    // fields
+    std::size_t at = 5;
+
+    while (at < size) {
+        if (size - at < 2) {
+            return std::nullopt;
+        }
+
+        const auto keyLen = readUInt(data + at, 2);
+
+        at += 2;
+
+        if (size - at < keyLen + 1) {
+            return std::nullopt;
+        }
+
+        std::string key {data + at, keyLen};
+
+        at += keyLen;
+
+        const auto tag = static_cast<ValueType>(data[at]);
+
+        ++at;
+
+        if (tag == ValueType::UInt) {
+            if (size - at < 8) {
+                return std::nullopt;
+            }
+
+            frame.fields[std::move(key)] = readUInt(data + at, 8);
+            at += 8;
+        } else if (tag == ValueType::Str) {
+            if (size - at < 4) {
+                return std::nullopt;
+            }
+
+            const auto strLen = readUInt(data + at, 4);
+
+            at += 4;
+
+            if (size - at < strLen) {
+                return std::nullopt;
+            }
+
+            frame.fields[std::move(key)] = std::string {data + at, strLen};
+            at += strLen;
+        } else {
+            return std::nullopt;
+        }
+    }
+
+    return frame;
+}
+
+} // namespace proto
+} // namespace jome
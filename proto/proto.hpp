@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2025 Philippe Proulx <eepp.ca>
+ *
+ * This software may be modified and distributed under the terms
+ * of the MIT license. See the LICENSE file for details.
+ */
+
+#ifndef _JOME_PROTO_PROTO_HPP
+#define _JOME_PROTO_PROTO_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <optional>
+#include <variant>
+#include <map>
+
+namespace jome {
+namespace proto {
+
+/*
+ * jome IPC protocol, version 2.
+ *
+ * A v2 client starts by sending a handshake:
+ *
+ *     0x01 'J' 'M' VERSION
+ *
+ * where `VERSION` (one byte) is the highest version which the client
+ * supports. The server replies with the same handshake containing the
+ * version it selected, which is never greater than the one of the
+ * client.
+ *
+ * Then both ends exchange frames:
+ *
+ *     LEN   u32   payload length
+ *     ID    u32   request ID (replies copy the ID of their request)
+ *     TYPE  u8    frame type (see `FrameType`)
+ *     FIELDS      zero or more fields up to the end of the payload
+ *
+ * where a field is:
+ *
+ *     KEYLEN  u16     key length
+ *     KEY             key (UTF-8)
+ *     TAG     u8      value type (see `ValueType`)
+ *     VALUE           u64 (unsigned integer) or
+ *                     u32 length followed with as many bytes (string)
+ *
+ * All integers are little-endian.
+ *
+ * Because the first byte of the handshake isn't printable, a server can
+ * tell a v2 client from a v1 one, which sends null-terminated UTF-8
+ * commands right away.
+ */
+
+// first bytes of a handshake
+constexpr char handshakeMagic[] = {'\x01', 'J', 'M'};
+
+// complete handshake size (bytes)
+constexpr std::size_t handshakeSize = sizeof handshakeMagic + 1;
+
+// highest supported protocol version
+constexpr unsigned int version = 2;
+
+// maximum payload size of a frame (bytes)
+constexpr std::uint32_t maxPayloadSize = 16 * 1024 * 1024;
+
+/*
+ * Frame type.
+ */
+enum class FrameType : std::uint8_t
+{
+    // client request
+    Request = 1,
+
+    // server reply
+    Reply = 2,
+
+    /*
+     * Server event (after the reply to a `subscribe` request, with the
+     * ID of this request).
+     */
+    Event = 3,
+};
+
+/*
+ * Field value type.
+ */
+enum class ValueType : std::uint8_t
+{
+    UInt = 0,
+    Str = 1,
+};
+
+/*
+ * Reply status (`status` field of a reply).
+ */
+enum class ReplyStatus : std::uint8_t
+{
+    // success (`output` field contains the result)
+    Ok = 0,
+
+    // user cancelled
+    Cancelled = 1,
+
+    // invalid request (`error` field contains a message)
+    Error = 2,
+};
+
+/*
+ * Field value.
+ */
+using Value = std::variant<std::uint64_t, std::string>;
+
+/*
+ * Fields of a frame, by key.
+ */
+using Fields = std::map<std::string, Value>;
+
+/*
+ * Protocol frame.
+ */
+struct Frame final
+{
+    /*
+     * Returns the unsigned integer value of the field `key`, if it
+     * exists and has this type.
+     */
+    std::optional<std::uint64_t> uintField(const std::string& key) const;
+
+    /*
+     * Returns the string value of the field `key`, if it exists and
+     * has this type, or `nullptr`.
+     */
+    const std::string *strField(const std::string& key) const;
+
+    // request ID
+    std::uint32_t reqId = 0;
+
+    // frame type
+    FrameType type = FrameType::Request;
+
+    // fields
+    Fields fields;
+};
+
+/*
+ * Returns the name of the default jome server of the current user,
+ * that is, `jome.socket.UID`.
+ */
+std::string defaultServerName();
+
+/*
+ * Returns a handshake for the version `version`.
+ */
+std::string encodeHandshake(unsigned int version = proto::version);
+
+/*
+ * Returns the version of the complete handshake `data`, or
+ * `std::nullopt` if it's not a handshake.
+ */
+std::optional<unsigned int> decodeHandshake(const char *data) noexcept;
+
+/*
+ * Returns the encoded frame `frame`, length prefix included.
+ */
+std::string encodeFrame(const Frame& frame);
+
+/*
+ * Frame decoder.
+ *
+ * Append received data with append(), and then call next() until it
+ * returns `std::nullopt`.
+ *
+ * Once next() finds invalid data, error() returns true and next()
+ * always returns `std::nullopt`: the connection is unusable.
+ */
+class FrameDecoder final
+{
+public:
+    /*
+     * Appends the `size` bytes of `data` to decode.
+     */
+    void append(const char *data, std::size_t size);
+
+    /*
+     * Decodes and returns the next complete frame, or returns
+     * `std::nullopt` if there's none yet (or on error).
+     */
+    std::optional<Frame> next();
+
+    bool error() const noexcept
+    {
+        return _error;
+    }
+
+    /*
+     * Number of buffered bytes which aren't decoded yet.
+     */
+    std::size_t bufferedSize() const noexcept
+    {
+        return _buf.size() - _pos;
+    }
+
+private:
+    std::optional<Frame> _decodePayload(const char *data, std::size_t size) const;
+
+private:
+    std::string _buf;
+    std::size_t _pos = 0;
+    bool _error = false;
+};
+
+} // namespace proto
+} // namespace jome
+
+#endif // _JOME_PROTO_PROTO_HPP